@@ -22,6 +22,7 @@
 #include "defs.h"
 #include "fs.h"
 #include "buf.h"
+#include "trace.h"
 
 struct {
   struct spinlock lock;
@@ -38,7 +39,7 @@ binit(void)
 {
   struct buf *b;
 
-  initlock(&bcache.lock, "bcache");
+  initticketlock(&bcache.lock, "bcache");
 
   // Create linked list of buffers
   bcache.head.prev = &bcache.head;
@@ -95,6 +96,7 @@ bread(uint dev, uint blockno)
   struct buf *b;
 
   b = bget(dev, blockno);
+  TRACEPOINT(TR_BREAD, blockno, !b->valid);
   if(!b->valid) {
     virtio_disk_rw(b, 0);
     b->valid = 1;
@@ -108,6 +110,7 @@ bwrite(struct buf *b)
 {
   if(!holdingsleep(&b->lock))
     panic("bwrite");
+  TRACEPOINT(TR_BWRITE, b->blockno, 0);
   virtio_disk_rw(b, 1);
 }
 
@@ -17,6 +17,7 @@
 #include "sleeplock.h"
 #include "fs.h"
 #include "file.h"
+#include "poll.h"
 #include "memlayout.h"
 #include "riscv.h"
 #include "defs.h"
@@ -50,6 +51,7 @@ struct {
   uint r;  // Read index
   uint w;  // Write index
   uint e;  // Edit index
+  struct pollentry *pollers;  // processes in poll() on it
 } cons;
 
 //
@@ -126,6 +128,23 @@ consoleread(int user_dst, uint64 dst, int n)
   return target - n;
 }
 
+//
+// poll()s on the console go here. a read is ready
+// once there is a whole line; writes never block.
+//
+int
+consolepoll(struct pollentry *e)
+{
+  int r = POLLOUT;
+
+  acquire(&cons.lock);
+  if(cons.r != cons.w)
+    r |= POLLIN;
+  polladd(e, &cons.pollers, &cons.lock);
+  release(&cons.lock);
+  return r;
+}
+
 //
 // the console input interrupt handler.
 // uartintr() calls this for input character.
@@ -170,6 +189,7 @@ consoleintr(int c)
         // has arrived.
         cons.w = cons.e;
         wakeup(&cons.r);
+        pollwake(cons.pollers);
       }
     }
     break;
@@ -189,4 +209,5 @@ consoleinit(void)
   // to consoleread and consolewrite.
   devsw[CONSOLE].read = consoleread;
   devsw[CONSOLE].write = consolewrite;
+  devsw[CONSOLE].poll = consolepoll;
 }
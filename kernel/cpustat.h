@@ -0,0 +1,7 @@
+// Per-hart statistics, filled in by the cpustat() system call.
+struct cpustat {
+  int online;      // Has the hart started scheduling?
+  uint64 idle;     // time CSR cycles spent idle in wfi
+  uint64 nipi;     // IPIs received
+  uint64 ntick;    // scheduler ticks taken
+};
@@ -5,9 +5,12 @@ struct inode;
 struct pipe;
 struct proc;
 struct spinlock;
+struct rwspinlock;
+struct lockclass;
 struct sleeplock;
 struct stat;
 struct superblock;
+struct trapframe;
 
 // bio.c
 void            binit(void);
@@ -26,6 +29,7 @@ void            consputc(int);
 int             exec(char*, char**);
 
 // file.c
+struct pollentry;
 struct file*    filealloc(void);
 void            fileclose(struct file*);
 struct file*    filedup(struct file*);
@@ -33,6 +37,7 @@ void            fileinit(void);
 int             fileread(struct file*, uint64, int n);
 int             filestat(struct file*, uint64 addr);
 int             filewrite(struct file*, uint64, int n);
+int             filepoll(struct file*, struct pollentry*);
 
 // fs.c
 void            fsinit(int);
@@ -59,10 +64,22 @@ void            ramdiskinit(void);
 void            ramdiskintr(void);
 void            ramdiskrw(struct buf*);
 
+// futex.c
+void            futexinit(void);
+int             futexwait(uint64, int, int);
+int             futexwake(uint64, int);
+
 // kalloc.c
 void*           kalloc(void);
 void            kfree(void *);
 void            kinit(void);
+void            kref(void *);
+
+// kprof.c
+extern int      kprofon;
+void            kprofinit(void);
+void            kproftick(uint64);
+int             kprof(int, uint64, int);
 
 // log.c
 void            initlog(int, struct superblock*);
@@ -75,6 +92,12 @@ int             pipealloc(struct file**, struct file**);
 void            pipeclose(struct pipe*, int);
 int             piperead(struct pipe*, uint64, int);
 int             pipewrite(struct pipe*, uint64, int);
+int             pipepoll(struct pipe*, struct pollentry*);
+
+// poll.c
+void            polladd(struct pollentry*, struct pollentry**, struct spinlock*);
+void            pollwake(struct pollentry*);
+int             poll(uint64, int, int);
 
 // printf.c
 void            printf(char*, ...);
@@ -85,10 +108,11 @@ void            printfinit(void);
 int             cpuid(void);
 void            exit(int);
 int             fork(void);
+int             clone(uint64, uint64, uint64);
 int             growproc(int);
-void            proc_mapstacks(pagetable_t);
+uint64          growshared(int);
 pagetable_t     proc_pagetable(struct proc *);
-void            proc_freepagetable(pagetable_t, uint64);
+void            proc_freepagetable(pagetable_t, uint64, uint64);
 int             kill(int);
 int             killed(struct proc*);
 void            setkilled(struct proc*);
@@ -101,13 +125,35 @@ void            sched(void);
 void            sleep(void*, struct spinlock*);
 void            userinit(void);
 int             wait(uint64);
+int             procstat(uint64, int);
+int             join(int, uint64);
 void            wakeup(void*);
+void            wakeproc(struct proc*, void*);
 void            yield(void);
 int             either_copyout(int user_dst, uint64 dst, void *src, uint64 len);
 int             either_copyin(void *dst, int user_src, uint64 src, uint64 len);
 void            procdump(void);
+struct proc*    findproc(int);
 int             dump(void);
 int             dump2(int pid, int register_num, uint64 return_value_addr);
+int             regsnap(uint64, int, uint64, uint64);
+uint64          trapframereg(struct trapframe*, int);
+
+// sched.c
+void            runqinit(void);
+void            runqput(struct proc*);
+struct proc*    runqget(void);
+void            idle(void);
+struct proc*    schedswitch(struct proc*);
+int             sethandoff(int);
+void            schedkick(struct proc*);
+int             schedtick(struct proc*);
+void            runqboost(void);
+void            schedfork(struct proc*, struct proc*);
+int             setpriority(int, int);
+int             getpriority(int);
+int             setaffinity(int, uint64);
+int             getaffinity(int);
 
 // swtch.S
 void            swtch(struct context*, struct context*);
@@ -116,15 +162,34 @@ void            swtch(struct context*, struct context*);
 void            acquire(struct spinlock*);
 int             holding(struct spinlock*);
 void            initlock(struct spinlock*, char*);
+void            initlockclass(struct spinlock*, char*, struct lockclass**);
+void            initlocknostat(struct spinlock*, char*);
+void            initticketlock(struct spinlock*, char*);
 void            release(struct spinlock*);
 void            push_off(void);
 void            pop_off(void);
+int             lockstat(uint64, int, int);
+int             lockbench(int, int);
+
+// rwspinlock.c
+void            initrwlock(struct rwspinlock*, char*);
+void            acquireread(struct rwspinlock*);
+void            releaseread(struct rwspinlock*);
+void            acquirewrite(struct rwspinlock*);
+void            releasewrite(struct rwspinlock*);
+int             holdingwrite(struct rwspinlock*);
+
+// sample.c
+uint64          sampleattach(int, uint64);
+int             sampledetach(void);
+void            sample(struct proc*, int);
 
 // sleeplock.c
 void            acquiresleep(struct sleeplock*);
 void            releasesleep(struct sleeplock*);
 int             holdingsleep(struct sleeplock*);
 void            initsleeplock(struct sleeplock*, char*);
+int             setsleepspin(int);
 
 // string.c
 int             memcmp(const void*, const void*, uint);
@@ -142,13 +207,33 @@ void            argaddr(int, uint64 *);
 int             fetchstr(uint64, char*, int);
 int             fetchaddr(uint64, uint64*);
 void            syscall();
+int             scstat(uint64, int, int);
+
+// timer.c
+struct timer;
+void            timersinit(void);
+void            timerinithart(void);
+void            timerstart(struct timer*, uint64);
+void            timerstop(struct timer*);
+int             timerintr(void);
+int             sleepuntil(uint64);
+void            tickstop(void);
+void            tickstart(void);
+
+// trace.c
+extern uint     tracemask;
+void            traceinit(void);
+void            trace(int, uint64, uint64, uint64, uint64);
 
 // trap.c
 extern uint     ticks;
+extern uint64   boottime;
 void            trapinit(void);
 void            trapinithart(void);
 extern struct spinlock tickslock;
 void            usertrapret(void);
+void            ipi(int);
+void            clockintr(void);
 
 // uart.c
 void            uartinit(void);
@@ -161,6 +246,8 @@ int             uartgetc(void);
 void            kvminit(void);
 void            kvminithart(void);
 void            kvmmap(pagetable_t, uint64, uint64, uint64, int);
+int             kvmmapstack(uint64, uint64);
+void            kvmsync(void);
 int             mappages(pagetable_t, uint64, uint64, uint64, int);
 pagetable_t     uvmcreate(void);
 void            uvmfirst(pagetable_t, uchar *, uint);
@@ -4,6 +4,7 @@
 #include "riscv.h"
 #include "spinlock.h"
 #include "proc.h"
+#include "vdso.h"
 #include "defs.h"
 #include "elf.h"
 
@@ -31,6 +32,10 @@ exec(char *path, char **argv)
   pagetable_t pagetable = 0, oldpagetable;
   struct proc *p = myproc();
 
+  // the old image can't go while other threads still use it.
+  if(p->tg->ref > 1)
+    return -1;
+
   begin_op();
 
   if((ip = namei(path)) == 0){
@@ -73,7 +78,7 @@ exec(char *path, char **argv)
   ip = 0;
 
   p = myproc();
-  uint64 oldsz = p->sz;
+  uint64 oldsz = p->tg->sz, oldtfva;
 
   // Allocate two pages at the next page boundary.
   // Make the first inaccessible as a stack guard.
@@ -122,17 +127,22 @@ exec(char *path, char **argv)
     
   // Commit to the user image.
   oldpagetable = p->pagetable;
-  p->pagetable = pagetable;
-  p->sz = sz;
+  oldtfva = p->tfva;
+  p->tg->pagetable = p->pagetable = pagetable;
+  p->tg->sz = sz;
+  p->tg->tfslots = 1;
+  p->tg->vdso->pid = p->pid;  // any threads are gone
+  p->tg->ring = 0;            // freed with the old page table
+  p->tfva = TRAPFRAME;
   p->trapframe->epc = elf.entry;  // initial program counter = main
   p->trapframe->sp = sp; // initial stack pointer
-  proc_freepagetable(oldpagetable, oldsz);
+  proc_freepagetable(oldpagetable, oldsz, oldtfva);
 
   return argc; // this ends up in a0, the first argument to main(argc, argv)
 
  bad:
   if(pagetable)
-    proc_freepagetable(pagetable, sz);
+    proc_freepagetable(pagetable, sz, TRAPFRAME);
   if(ip){
     iunlockput(ip);
     end_op();
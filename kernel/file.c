@@ -8,21 +8,28 @@
 #include "param.h"
 #include "fs.h"
 #include "spinlock.h"
+#include "rwspinlock.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "poll.h"
 #include "stat.h"
 #include "proc.h"
 
 struct devsw devsw[NDEV];
+
+// only fileclose() holds ftable.lock for writing, to drop
+// a reference and free the file; finding a free file and
+// taking another reference hold it for reading, and change
+// f->ref atomically.
 struct {
-  struct spinlock lock;
+  struct rwspinlock lock;
   struct file file[NFILE];
 } ftable;
 
 void
 fileinit(void)
 {
-  initlock(&ftable.lock, "ftable");
+  initrwlock(&ftable.lock, "ftable");
 }
 
 // Allocate a file structure.
@@ -31,15 +38,14 @@ filealloc(void)
 {
   struct file *f;
 
-  acquire(&ftable.lock);
+  acquireread(&ftable.lock);
   for(f = ftable.file; f < ftable.file + NFILE; f++){
-    if(f->ref == 0){
-      f->ref = 1;
-      release(&ftable.lock);
+    if(f->ref == 0 && __sync_bool_compare_and_swap(&f->ref, 0, 1)){
+      releaseread(&ftable.lock);
       return f;
     }
   }
-  release(&ftable.lock);
+  releaseread(&ftable.lock);
   return 0;
 }
 
@@ -47,11 +53,10 @@ filealloc(void)
 struct file*
 filedup(struct file *f)
 {
-  acquire(&ftable.lock);
-  if(f->ref < 1)
+  acquireread(&ftable.lock);
+  if(__sync_fetch_and_add(&f->ref, 1) < 1)
     panic("filedup");
-  f->ref++;
-  release(&ftable.lock);
+  releaseread(&ftable.lock);
   return f;
 }
 
@@ -61,17 +66,17 @@ fileclose(struct file *f)
 {
   struct file ff;
 
-  acquire(&ftable.lock);
+  acquirewrite(&ftable.lock);
   if(f->ref < 1)
     panic("fileclose");
   if(--f->ref > 0){
-    release(&ftable.lock);
+    releasewrite(&ftable.lock);
     return;
   }
   ff = *f;
   f->ref = 0;
   f->type = FD_NONE;
-  release(&ftable.lock);
+  releasewrite(&ftable.lock);
 
   if(ff.type == FD_PIPE){
     pipeclose(ff.pipe, ff.writable);
@@ -101,6 +106,27 @@ filestat(struct file *f, uint64 addr)
   return -1;
 }
 
+// Which of POLLIN, POLLOUT and POLLHUP apply to f now.
+// A pipe or a device that can block lists e, to wake
+// the process in poll() when that may change.
+int
+filepoll(struct file *f, struct pollentry *e)
+{
+  int r;
+
+  if(f->type == FD_PIPE)
+    r = pipepoll(f->pipe, e);
+  else if(f->type == FD_DEVICE && f->major >= 0 && f->major < NDEV && devsw[f->major].poll)
+    r = devsw[f->major].poll(e);
+  else
+    r = POLLIN | POLLOUT;
+  if(!f->readable)
+    r &= ~POLLIN;
+  if(!f->writable)
+    r &= ~POLLOUT;
+  return r;
+}
+
 // Read from file f.
 // addr is a user virtual address.
 int
@@ -29,12 +29,23 @@ struct inode {
   uint addrs[NDIRECT+1];
 };
 
+// a process in poll() waiting on a pipe or device, listed
+// with it; see poll.c.
+struct pollentry {
+  struct pollwait *pw;
+  struct pollentry **list;  // the list it is on, or 0
+  struct spinlock *lock;    // protects *list
+  struct pollentry *next;
+};
+
 // map major device number to device functions.
 struct devsw {
   int (*read)(int, uint64, int);
   int (*write)(int, uint64, int);
+  int (*poll)(struct pollentry*);  // POLLIN/POLLOUT, listing the entry
 };
 
 extern struct devsw devsw[];
 
 #define CONSOLE 1
+#define TRACE 2
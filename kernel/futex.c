@@ -0,0 +1,173 @@
+//
+// Futexes: sleeping on a word of user memory.
+//
+// futexwait(addr, val) sleeps for as long as the int at
+// user address addr holds val, until futexwake() is called
+// on the same word. User-space locks spin on the word only
+// when it is contended, and sleep here instead of spinning.
+//
+// Waiters are kept in a hash table keyed by the word's
+// physical address, so processes sharing a page (threads,
+// or forked processes with memory from sbrkshared()) meet
+// at the same futex whatever address each maps it at.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "timer.h"
+#include "defs.h"
+
+#define NFUTEX 64
+
+// a process in futexwait(), on its kernel stack.
+struct futexw {
+  uint64 pa;            // physical address of the word
+  struct proc *p;
+  int woken;            // set by futexwake()
+  int timedout;         // set by futextimeout()
+  struct timer t;       // for a timeout
+  struct futexw *next;
+};
+
+struct {
+  struct spinlock lock;
+  struct futexw *head;
+} futextab[NFUTEX];
+
+#define FUTEXHASH(pa) (((pa) / sizeof(int)) % NFUTEX)
+
+void
+futexinit(void)
+{
+  for(int i = 0; i < NFUTEX; i++)
+    initlock(&futextab[i].lock, "futex");
+}
+
+// physical address of the aligned int at user address
+// addr in the current process, or 0 if it isn't mapped.
+static uint64
+futexpa(uint64 addr)
+{
+  uint64 pa;
+
+  if(addr % sizeof(int) != 0)
+    return 0;
+  if((pa = walkaddr(myproc()->pagetable, addr)) == 0)
+    return 0;
+  return pa + (addr % PGSIZE);
+}
+
+// the timer of a timed futexwait() went off.
+static void
+futextimeout(struct timer *t)
+{
+  struct futexw *w = t->arg;
+
+  acquire(&futextab[FUTEXHASH(w->pa)].lock);
+  w->timedout = 1;
+  wakeproc(w->p, w);
+  release(&futextab[FUTEXHASH(w->pa)].lock);
+}
+
+// Sleep until futexwake() is called on the int at addr,
+// provided it holds val, giving up after timeout ticks
+// unless timeout is 0.
+// Returns 0 if woken, 1 if the timeout expired, and -1
+// if *addr != val, addr is bad or the caller was killed.
+int
+futexwait(uint64 addr, int val, int timeout)
+{
+  struct proc *p = myproc();
+  struct futexw w, **wp;
+  uint64 pa;
+  int r;
+
+  if((pa = futexpa(addr)) == 0 || timeout < 0)
+    return -1;
+
+  w.pa = pa;
+  w.p = p;
+  w.woken = 0;
+  w.timedout = 0;
+  // the timer takes the bucket lock, so start it before
+  // acquiring that and stop it after releasing it.
+  if(timeout){
+    w.t.fn = futextimeout;
+    w.t.arg = &w;
+    timerstart(&w.t, r_time() + (uint64)timeout * TICKCYCLES);
+  }
+
+  acquire(&futextab[FUTEXHASH(pa)].lock);
+  // futexwake() on this word takes the same lock, so
+  // it can't slip in between this check and the sleep.
+  if(*(volatile int*)pa != val){
+    release(&futextab[FUTEXHASH(pa)].lock);
+    if(timeout)
+      timerstop(&w.t);
+    return -1;
+  }
+  // join the end of the queue, so waiters wake in order.
+  w.next = 0;
+  for(wp = &futextab[FUTEXHASH(pa)].head; *wp; wp = &(*wp)->next)
+    ;
+  *wp = &w;
+
+  r = 0;
+  while(!w.woken){
+    if(killed(p)){
+      r = -1;
+      break;
+    }
+    if(w.timedout){
+      r = 1;
+      break;
+    }
+    sleep(&w, &futextab[FUTEXHASH(pa)].lock);
+  }
+
+  if(!w.woken){
+    for(wp = &futextab[FUTEXHASH(pa)].head; *wp != &w; wp = &(*wp)->next)
+      ;
+    *wp = w.next;
+  }
+  release(&futextab[FUTEXHASH(pa)].lock);
+  if(timeout)
+    timerstop(&w.t);
+  return r;
+}
+
+// Wake up to n processes waiting in futexwait() on the int
+// at addr, in the order they started waiting.
+// Returns the number woken, or -1 if addr is bad.
+int
+futexwake(uint64 addr, int n)
+{
+  struct futexw *w, **wp;
+  uint64 pa;
+  int woken;
+
+  if((pa = futexpa(addr)) == 0)
+    return -1;
+
+  acquire(&futextab[FUTEXHASH(pa)].lock);
+  woken = 0;
+  for(wp = &futextab[FUTEXHASH(pa)].head; *wp && woken < n; ){
+    w = *wp;
+    if(w->pa != pa){
+      wp = &w->next;
+      continue;
+    }
+    // w stays valid: its owner can't return from
+    // futexwait() until we release the lock.
+    *wp = w->next;
+    w->woken = 1;
+    wakeproc(w->p, w);
+    woken++;
+  }
+  release(&futextab[FUTEXHASH(pa)].lock);
+  return woken;
+}
@@ -21,12 +21,17 @@ struct run {
 struct {
   struct spinlock lock;
   struct run *freelist;
+  // references to each allocated page. only pages shared
+  // between page tables (see kref()) have more than one.
+  ushort ref[(PHYSTOP-KERNBASE)/PGSIZE];
 } kmem;
 
+#define PAGEREF(pa) kmem.ref[((uint64)(pa) - KERNBASE) / PGSIZE]
+
 void
 kinit()
 {
-  initlock(&kmem.lock, "kmem");
+  initticketlock(&kmem.lock, "kmem");
   freerange(end, (void*)PHYSTOP);
 }
 
@@ -39,10 +44,11 @@ freerange(void *pa_start, void *pa_end)
     kfree(p);
 }
 
-// Free the page of physical memory pointed at by pa,
-// which normally should have been returned by a
-// call to kalloc().  (The exception is when
-// initializing the allocator; see kinit above.)
+// Drop a reference to the page of physical memory pointed
+// at by pa, which normally should have been returned by a
+// call to kalloc(), and free it if that was the last.
+// (The exception is when initializing the allocator;
+// see kinit above.)
 void
 kfree(void *pa)
 {
@@ -51,6 +57,21 @@ kfree(void *pa)
   if(((uint64)pa % PGSIZE) != 0 || (char*)pa < end || (uint64)pa >= PHYSTOP)
     panic("kfree");
 
+  // a page with one reference is the caller's alone, and
+  // no one else can kref() it, so only a shared page needs
+  // the lock to drop a reference. that keeps an ordinary
+  // free to the one acquire below.
+  if(PAGEREF(pa) > 1){
+    acquire(&kmem.lock);
+    if(PAGEREF(pa) > 1){
+      PAGEREF(pa)--;
+      release(&kmem.lock);
+      return;
+    }
+    release(&kmem.lock);
+  }
+  PAGEREF(pa) = 0;
+
   // Fill with junk to catch dangling refs.
   memset(pa, 1, PGSIZE);
 
@@ -72,11 +93,29 @@ kalloc(void)
 
   acquire(&kmem.lock);
   r = kmem.freelist;
-  if(r)
+  if(r){
     kmem.freelist = r->next;
+    PAGEREF(r) = 1;
+  }
   release(&kmem.lock);
 
   if(r)
     memset((char*)r, 5, PGSIZE); // fill with junk
   return (void*)r;
 }
+
+// Take another reference to the allocated page at pa,
+// which kfree() will then leave alone until the last
+// reference to it is dropped.
+void
+kref(void *pa)
+{
+  if(((uint64)pa % PGSIZE) != 0 || (char*)pa < end || (uint64)pa >= PHYSTOP)
+    panic("kref");
+
+  acquire(&kmem.lock);
+  if(PAGEREF(pa) == 0 || PAGEREF(pa) == 0xffff)
+    panic("kref ref");
+  PAGEREF(pa)++;
+  release(&kmem.lock);
+}
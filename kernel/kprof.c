@@ -0,0 +1,146 @@
+//
+// Statistical profiler for the kernel.
+//
+// While it is on, each timer tick a hart takes in the kernel
+// records the interrupted pc and a few callers, found by
+// following the frame pointers that -fno-omit-frame-pointer
+// keeps, into that hart's buffer; ticks in user space are
+// just counted. kprof() starts and stops it and reads the
+// samples out, for user/prof to fold against kernel.sym.
+// Code that runs with interrupts off can't be sampled.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "kprof.h"
+#include "defs.h"
+
+#define NKPROF 256   // samples per hart
+
+// could fp be a frame pointer on the stack page at bottom?
+#define ONSTACK(fp, bottom) \
+  ((fp) % 8 == 0 && (fp) >= (bottom) + 16 && (fp) <= (bottom) + PGSIZE)
+
+int kprofon;
+
+struct {
+  struct spinlock lock;
+  int n;                      // samples in s
+  struct kprofstat st;
+  struct kpsample s[NKPROF];
+} kp[NCPU];
+
+void
+kprofinit(void)
+{
+  for(int i = 0; i < NCPU; i++)
+    initlock(&kp[i].lock, "kprof");
+}
+
+// Record a timer tick on this hart, in the kernel at sepc,
+// or in user space if sepc is 0. Called from the trap
+// handler with interrupts off.
+void
+kproftick(uint64 sepc)
+{
+  struct kpsample *s;
+  uint64 fp, bottom;
+  int i, id;
+
+  if(!kprofon)
+    return;
+  id = cpuid();
+  acquire(&kp[id].lock);
+  if(sepc == 0){
+    kp[id].st.user++;
+  } else if(kp[id].n == NKPROF){
+    kp[id].st.kernel++;
+    kp[id].st.dropped++;
+  } else {
+    kp[id].st.kernel++;
+    s = &kp[id].s[kp[id].n++];
+    memset(s, 0, sizeof(*s));
+    s->pc[0] = sepc;
+    // the return address is 8 bytes below a frame pointer,
+    // and the caller's frame pointer 16. skip this frame and
+    // kerneltrap()'s, whose saved frame pointer is the
+    // interrupted one, and stop at anything off this stack.
+    fp = r_fp();
+    bottom = PGROUNDDOWN(fp);
+    fp = *(uint64*)(fp - 16);
+    if(ONSTACK(fp, bottom))
+      fp = *(uint64*)(fp - 16);
+    for(i = 1; i < KPDEPTH && ONSTACK(fp, bottom); i++){
+      s->pc[i] = *(uint64*)(fp - 8);
+      fp = *(uint64*)(fp - 16);
+    }
+  }
+  release(&kp[id].lock);
+}
+
+// Start, stop or read the profiler; see kprof.h.
+// Reading takes up to n samples from the harts' buffers
+// into the struct kpsample array at user address addr,
+// and returns how many.
+int
+kprof(int cmd, uint64 addr, int n)
+{
+  struct proc *p = myproc();
+  struct kprofstat st;
+  int i, k, done;
+
+  switch(cmd){
+  case KPROF_START:
+    for(i = 0; i < NCPU; i++){
+      acquire(&kp[i].lock);
+      kp[i].n = 0;
+      memset(&kp[i].st, 0, sizeof(kp[i].st));
+      release(&kp[i].lock);
+    }
+    kprofon = 1;
+    // harts that stopped their ticks must restart them.
+    push_off();
+    for(i = 0; i < NCPU; i++){
+      if(i == cpuid())
+        tickstart();
+      else if(cpus[i].online)
+        ipi(i);
+    }
+    pop_off();
+    return 0;
+  case KPROF_STOP:
+    kprofon = 0;
+    return 0;
+  case KPROF_STAT:
+    memset(&st, 0, sizeof(st));
+    for(i = 0; i < NCPU; i++){
+      acquire(&kp[i].lock);
+      st.kernel += kp[i].st.kernel;
+      st.user += kp[i].st.user;
+      st.dropped += kp[i].st.dropped;
+      release(&kp[i].lock);
+    }
+    return copyout(p->pagetable, addr, (char*)&st, sizeof(st));
+  case KPROF_READ:
+    done = 0;
+    for(i = 0; i < NCPU && done < n; i++){
+      acquire(&kp[i].lock);
+      k = kp[i].n < n - done ? kp[i].n : n - done;
+      if(copyout(p->pagetable, addr + done * sizeof(struct kpsample),
+                 (char*)kp[i].s, k * sizeof(struct kpsample)) < 0){
+        release(&kp[i].lock);
+        return -1;
+      }
+      kp[i].n -= k;
+      memmove(kp[i].s, kp[i].s + k, kp[i].n * sizeof(struct kpsample));
+      release(&kp[i].lock);
+      done += k;
+    }
+    return done;
+  }
+  return -1;
+}
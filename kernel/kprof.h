@@ -0,0 +1,21 @@
+// The kernel profiler's samples and counts, read with kprof().
+#define KPDEPTH 5          // pcs per sample
+
+// where a timer tick found the kernel: pc[0] is the
+// interrupted pc, and the rest its callers, innermost
+// first, as far as the frame pointers go, then 0.
+struct kpsample {
+  uint64 pc[KPDEPTH];
+};
+
+struct kprofstat {
+  uint64 kernel;           // ticks sampled in the kernel
+  uint64 user;             // ticks in user space
+  uint64 dropped;          // kernel samples lost to full buffers
+};
+
+// kprof() commands
+#define KPROF_STOP  0
+#define KPROF_START 1      // clear the buffers and counts, and sample
+#define KPROF_READ  2      // take up to n struct kpsamples
+#define KPROF_STAT  3      // get the struct kprofstat
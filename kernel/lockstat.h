@@ -0,0 +1,13 @@
+// Spin lock statistics, by lock name, summed over the harts
+// by the lockstat() system call. Times are in time CSR cycles.
+#define LOCKNAME 16        // names differing only past this are one class
+#define LOCKBENCHMS 10000  // longest run lockbench() allows
+
+struct lockstat {
+  char name[LOCKNAME];
+  int nlocks;              // initlock()s with this name since boot
+  uint64 nacquire;         // acquisitions
+  uint64 ncontend;         // acquisitions that had to spin
+  uint64 spins;            // times round the spin loop, in all
+  uint64 maxhold;          // longest held
+};
@@ -20,8 +20,14 @@ main()
     kvminit();       // create kernel page table
     kvminithart();   // turn on paging
     procinit();      // process table
+    runqinit();      // scheduler run queues
+    futexinit();     // futex wait queues
+    timersinit();    // timer queues
+    kprofinit();     // kernel profiler buffers
+    traceinit();     // trace device
     trapinit();      // trap vectors
     trapinithart();  // install kernel trap vector
+    timerinithart(); // start scheduler ticks
     plicinit();      // set up interrupt controller
     plicinithart();  // ask PLIC for device interrupts
     binit();         // buffer cache
@@ -38,6 +44,7 @@ main()
     printf("hart %d starting\n", cpuid());
     kvminithart();    // turn on paging
     trapinithart();   // install kernel trap vector
+    timerinithart();  // start scheduler ticks
     plicinithart();   // ask PLIC for device interrupts
   }
 
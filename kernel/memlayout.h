@@ -27,6 +27,7 @@
 
 // core local interruptor (CLINT), which contains the timer.
 #define CLINT 0x2000000L
+#define CLINT_MSIP(hartid) (CLINT + 4*(hartid)) // raise a software interrupt
 #define CLINT_MTIMECMP(hartid) (CLINT + 0x4000 + 8*(hartid))
 #define CLINT_MTIME (CLINT + 0xBFF8) // cycles since boot.
 
@@ -62,6 +63,15 @@
 //   fixed-size stack
 //   expandable heap
 //   ...
+//   SAMPLES (struct samplering, while sampleattach()ed)
+//   RING (struct ring, once ringsetup() is called)
+//   VDSO (struct vdso, read-only)
+//   trapframes of threads created by clone(), one page each
 //   TRAPFRAME (p->trapframe, used by the trampoline)
 //   TRAMPOLINE (the same page as in the kernel)
 #define TRAPFRAME (TRAMPOLINE - PGSIZE)
+#define TFSLOT(i) (TRAPFRAME - (i)*PGSIZE)
+#define VDSO (TFSLOT(NTHREAD-1) - PGSIZE)
+#define RING (VDSO - PGSIZE)
+#define SAMPLES (RING - PGSIZE)
+#define MAXUSERVA SAMPLES
@@ -1,6 +1,7 @@
-#define NPROC        64  // maximum number of processes
+#define NPROC       512  // maximum number of processes, allocated on demand
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
+#define NTHREAD      64  // maximum threads sharing an address space
 #define NFILE       100  // open files per system
 #define NINODE       50  // maximum number of active i-nodes
 #define NDEV         10  // maximum major device number
@@ -11,3 +12,9 @@
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
 #define FSSIZE       2000  // size of file system in blocks
 #define MAXPATH      128   // maximum file path name
+#define TIMEBASE   10000000 // time CSR cycles per second in qemu
+#define TICKCYCLES 1000000  // time CSR cycles per tick; about 1/10th second in qemu
+#define NMLFQ         3  // scheduler priority levels
+#define BOOSTTICKS   50  // ticks between scheduler priority boosts
+#define NICE_MIN    -20  // most favoured nice value
+#define NICE_MAX     19  // least favoured nice value
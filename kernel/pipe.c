@@ -7,6 +7,7 @@
 #include "fs.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "poll.h"
 
 #define PIPESIZE 512
 
@@ -17,8 +18,11 @@ struct pipe {
   uint nwrite;    // number of bytes written
   int readopen;   // read fd is still open
   int writeopen;  // write fd is still open
+  struct pollentry *pollers;  // processes in poll() on it
 };
 
+static struct lockclass *pipeclass;  // see initlockclass()
+
 int
 pipealloc(struct file **f0, struct file **f1)
 {
@@ -34,7 +38,8 @@ pipealloc(struct file **f0, struct file **f1)
   pi->writeopen = 1;
   pi->nwrite = 0;
   pi->nread = 0;
-  initlock(&pi->lock, "pipe");
+  pi->pollers = 0;
+  initlockclass(&pi->lock, "pipe", &pipeclass);
   (*f0)->type = FD_PIPE;
   (*f0)->readable = 1;
   (*f0)->writable = 0;
@@ -66,6 +71,7 @@ pipeclose(struct pipe *pi, int writable)
     pi->readopen = 0;
     wakeup(&pi->nwrite);
   }
+  pollwake(pi->pollers);
   if(pi->readopen == 0 && pi->writeopen == 0){
     release(&pi->lock);
     kfree((char*)pi);
@@ -87,6 +93,7 @@ pipewrite(struct pipe *pi, uint64 addr, int n)
     }
     if(pi->nwrite == pi->nread + PIPESIZE){ //DOC: pipewrite-full
       wakeup(&pi->nread);
+      pollwake(pi->pollers);
       sleep(&pi->nwrite, &pi->lock);
     } else {
       char ch;
@@ -97,6 +104,7 @@ pipewrite(struct pipe *pi, uint64 addr, int n)
     }
   }
   wakeup(&pi->nread);
+  pollwake(pi->pollers);
   release(&pi->lock);
 
   return i;
@@ -125,6 +133,26 @@ piperead(struct pipe *pi, uint64 addr, int n)
       break;
   }
   wakeup(&pi->nwrite);  //DOC: piperead-wakeup
+  pollwake(pi->pollers);
   release(&pi->lock);
   return i;
 }
+
+// Which of POLLIN, POLLOUT and POLLHUP apply to pi now,
+// listing e to be woken when that may change.
+int
+pipepoll(struct pipe *pi, struct pollentry *e)
+{
+  int r = 0;
+
+  acquire(&pi->lock);
+  if(pi->nread != pi->nwrite || !pi->writeopen)
+    r |= POLLIN;
+  if(pi->nwrite != pi->nread + PIPESIZE || !pi->readopen)
+    r |= POLLOUT;
+  if(!pi->readopen || !pi->writeopen)
+    r |= POLLHUP;
+  polladd(e, &pi->pollers, &pi->lock);
+  release(&pi->lock);
+  return r;
+}
@@ -0,0 +1,176 @@
+//
+// poll(): wait for any of several files to be ready.
+//
+// A process in poll() lists a pollentry for each file it is
+// waiting on with that file's pipe or device, then sleeps on
+// a pollwait of its own. When a pipe or the console may have
+// become ready it calls pollwake() on its list, which wakes
+// just the processes polling it; they then check their files
+// again. Files and other devices never block, so are always
+// ready.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "fs.h"
+#include "sleeplock.h"
+#include "file.h"
+#include "poll.h"
+#include "timer.h"
+#include "defs.h"
+
+// a process in poll(), on its kernel stack.
+struct pollwait {
+  struct spinlock lock;
+  struct proc *p;
+  int ready;            // set by pollwake()
+  int timedout;         // set by polltimeout()
+  struct timer t;       // for a timeout
+};
+
+// Add e to list, protected by lock, unless it is on
+// one already. Caller holds lock.
+void
+polladd(struct pollentry *e, struct pollentry **list, struct spinlock *lock)
+{
+  if(e->list)
+    return;
+  e->list = list;
+  e->lock = lock;
+  e->next = *list;
+  *list = e;
+}
+
+// Take e off the list it is on, if any.
+static void
+polldel(struct pollentry *e)
+{
+  struct pollentry **ep;
+
+  if(e->list == 0)
+    return;
+  acquire(e->lock);
+  for(ep = e->list; *ep != e; ep = &(*ep)->next)
+    ;
+  *ep = e->next;
+  release(e->lock);
+  e->list = 0;
+}
+
+// Wake the processes polling with entries on list.
+// Caller holds the list's lock.
+void
+pollwake(struct pollentry *list)
+{
+  struct pollentry *e;
+
+  for(e = list; e; e = e->next){
+    acquire(&e->pw->lock);
+    e->pw->ready = 1;
+    wakeproc(e->pw->p, e->pw);
+    release(&e->pw->lock);
+  }
+}
+
+// the timer of a poll() with a timeout went off.
+static void
+polltimeout(struct timer *t)
+{
+  struct pollwait *pw = t->arg;
+
+  acquire(&pw->lock);
+  pw->timedout = 1;
+  wakeproc(pw->p, pw);
+  release(&pw->lock);
+}
+
+// Wait until one of the n files in the struct pollfd array
+// at user address addr is ready for its events, or timeout
+// ticks pass; a timeout of 0 doesn't wait, and -1 waits for
+// ever. Fills in revents.
+// Returns the number of ready files, 0 on timeout, or -1.
+int
+poll(uint64 addr, int n, int timeout)
+{
+  struct proc *p = myproc();
+  struct pollfd fds[NOFILE];
+  struct file *files[NOFILE];
+  struct pollentry ents[NOFILE];
+  struct pollwait pw;
+  int i, nready, fd;
+
+  if(n < 0 || n > NOFILE)
+    return -1;
+  if(copyin(p->pagetable, (char*)fds, addr, n * sizeof(fds[0])) < 0)
+    return -1;
+
+  initlocknostat(&pw.lock, "poll");
+  pw.p = p;
+  pw.ready = 0;
+  pw.timedout = 0;
+  for(i = 0; i < n; i++){
+    // hold the files, in case another thread closes them.
+    fd = fds[i].fd;
+    files[i] = 0;
+    acquire(&p->tg->lock);
+    if(fd >= 0 && fd < NOFILE && p->tg->ofile[fd])
+      files[i] = filedup(p->tg->ofile[fd]);
+    release(&p->tg->lock);
+    ents[i].pw = &pw;
+    ents[i].list = 0;
+  }
+  // the timer takes pw.lock, so start it before acquiring
+  // that and stop it after releasing it.
+  if(timeout > 0){
+    pw.t.fn = polltimeout;
+    pw.t.arg = &pw;
+    timerstart(&pw.t, r_time() + (uint64)timeout * TICKCYCLES);
+  }
+
+  for(;;){
+    // a file that becomes ready after being checked
+    // below sets pw.ready again.
+    acquire(&pw.lock);
+    pw.ready = 0;
+    release(&pw.lock);
+
+    nready = 0;
+    for(i = 0; i < n; i++){
+      fds[i].revents = 0;
+      if(files[i])
+        fds[i].revents = filepoll(files[i], &ents[i]) & (fds[i].events | POLLHUP);
+      else if(fds[i].fd >= 0)
+        fds[i].revents = POLLNVAL;
+      if(fds[i].revents)
+        nready++;
+    }
+    if(nready || timeout == 0)
+      break;
+
+    acquire(&pw.lock);
+    while(!pw.ready && !pw.timedout && !killed(p))
+      sleep(&pw, &pw.lock);
+    release(&pw.lock);
+    if(killed(p)){
+      nready = -1;
+      break;
+    }
+    if(pw.timedout)
+      break;
+  }
+
+  if(timeout > 0)
+    timerstop(&pw.t);
+  for(i = 0; i < n; i++){
+    polldel(&ents[i]);
+    if(files[i])
+      fileclose(files[i]);
+  }
+  if(nready >= 0 && copyout(p->pagetable, addr, (char*)fds, n * sizeof(fds[0])) < 0)
+    return -1;
+  return nready;
+}
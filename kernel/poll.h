@@ -0,0 +1,11 @@
+// An entry in the array given to poll().
+struct pollfd {
+  int fd;          // file descriptor, or -1 to ignore
+  short events;    // what to wait for
+  short revents;   // what poll() found
+};
+
+#define POLLIN   0x1   // read won't block
+#define POLLOUT  0x4   // write won't block
+#define POLLHUP  0x10  // the other end of a pipe is closed
+#define POLLNVAL 0x20  // fd isn't open
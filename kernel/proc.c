@@ -3,20 +3,42 @@
 #include "memlayout.h"
 #include "riscv.h"
 #include "spinlock.h"
+#include "rwspinlock.h"
 #include "proc.h"
+#include "procstat.h"
+#include "vdso.h"
+#include "regset.h"
+#include "trace.h"
 #include "defs.h"
 
 struct cpu cpus[NCPU];
 
-struct proc proc[NPROC];
+// every struct proc allocated so far, linked through p->allnext.
+// procs are never handed back to kalloc(), so the list only
+// grows at its head and can be walked without a lock.
+struct proc *allproc;
+
+// UNUSED procs ready for allocproc(), and the number of
+// procs (and kernel stacks) created so far, up to NPROC.
+struct {
+  struct spinlock lock;
+  struct proc *free;
+  int n;
+} ptable;
 
 struct proc *initproc;
 
+// which proc has which pid: held for writing to give out
+// or take back a pid, for reading to look one up.
+// taken after p->lock, so lookups must drop it before
+// locking the proc they found.
 int nextpid = 1;
-struct spinlock pid_lock;
+struct rwspinlock pidlock;
 
 extern void forkret(void);
 static void freeproc(struct proc *p);
+static void tgput(struct proc *p);
+static void switchdone(void);
 
 extern char trampoline[]; // trampoline.S
 
@@ -26,36 +48,52 @@ extern char trampoline[]; // trampoline.S
 // must be acquired before any p->lock.
 struct spinlock wait_lock;
 
-// Allocate a page for each process's kernel stack.
-// Map it high in memory, followed by an invalid
-// guard page.
-void
-proc_mapstacks(pagetable_t kpgtbl)
-{
-  struct proc *p;
-  
-  for(p = proc; p < &proc[NPROC]; p++) {
-    char *pa = kalloc();
-    if(pa == 0)
-      panic("kalloc");
-    uint64 va = KSTACK((int) (p - proc));
-    kvmmap(kpgtbl, va, (uint64)pa, PGSIZE, PTE_R | PTE_W);
-  }
-}
-
 // initialize the proc table.
+// procs are created on demand by allocproc().
 void
 procinit(void)
 {
-  struct proc *p;
-  
-  initlock(&pid_lock, "nextpid");
+  initrwlock(&pidlock, "pid");
   initlock(&wait_lock, "wait_lock");
-  for(p = proc; p < &proc[NPROC]; p++) {
-      initlock(&p->lock, "proc");
-      p->state = UNUSED;
-      p->kstack = KSTACK((int) (p - proc));
+  initlock(&ptable.lock, "ptable");
+}
+
+// Carve a fresh page into struct procs, give each a
+// kernel stack mapped high in memory below an invalid
+// guard page, and put them on the free list.
+// Caller must hold ptable.lock.
+static void
+procgrow(void)
+{
+  struct proc *p, *pp;
+  char *pa;
+
+  if(ptable.n >= NPROC || (pp = (struct proc*)kalloc()) == 0)
+    return;
+  memset(pp, 0, PGSIZE);
+
+  for(p = pp; (char*)(p + 1) <= (char*)pp + PGSIZE && ptable.n < NPROC; p++){
+    if((pa = kalloc()) == 0)
+      break;
+    p->kstack = KSTACK(ptable.n);
+    if(kvmmapstack(p->kstack, (uint64)pa) < 0){
+      kfree(pa);
+      break;
+    }
+    ptable.n++;
+    initlock(&p->lock, "proc");
+    p->state = UNUSED;
+    p->freenext = ptable.free;
+    ptable.free = p;
+
+    // make p's fields visible before publishing it.
+    p->allnext = allproc;
+    __sync_synchronize();
+    allproc = p;
   }
+
+  if(p == pp)
+    kfree((void*)pp);
 }
 
 // Must be called with interrupts disabled,
@@ -89,40 +127,55 @@ myproc(void)
   return p;
 }
 
-int
-allocpid()
+static void
+allocpid(struct proc *p)
 {
-  int pid;
-  
-  acquire(&pid_lock);
-  pid = nextpid;
+  acquirewrite(&pidlock);
+  p->pid = nextpid;
   nextpid = nextpid + 1;
-  release(&pid_lock);
+  releasewrite(&pidlock);
+}
 
-  return pid;
+// The proc that had pid when we looked, without locking
+// it; the caller must lock it and check p->pid again.
+static struct proc*
+lookuppid(int pid)
+{
+  struct proc *p;
+
+  acquireread(&pidlock);
+  for(p = allproc; p; p = p->allnext)
+    if(p->pid == pid)
+      break;
+  releaseread(&pidlock);
+  return p;
 }
 
-// Look in the process table for an UNUSED proc.
+// Take an UNUSED proc off the free list, growing the
+// process table if the list is empty.
 // If found, initialize state required to run in the kernel,
-// and return with p->lock held.
+// and return with p->lock held. The caller gives it
+// user memory with tgalloc() or tgjoin().
 // If there are no free procs, or a memory allocation fails, return 0.
 static struct proc*
 allocproc(void)
 {
   struct proc *p;
 
-  for(p = proc; p < &proc[NPROC]; p++) {
-    acquire(&p->lock);
-    if(p->state == UNUSED) {
-      goto found;
-    } else {
-      release(&p->lock);
-    }
-  }
-  return 0;
+  acquire(&ptable.lock);
+  if(ptable.free == 0)
+    procgrow();
+  p = ptable.free;
+  if(p)
+    ptable.free = p->freenext;
+  release(&ptable.lock);
+  if(p == 0)
+    return 0;
 
-found:
-  p->pid = allocpid();
+  acquire(&p->lock);
+  if(p->state != UNUSED)
+    panic("allocproc");
+  allocpid(p);
   p->state = USED;
 
   // Allocate a trapframe page.
@@ -132,14 +185,6 @@ found:
     return 0;
   }
 
-  // An empty user page table.
-  p->pagetable = proc_pagetable(p);
-  if(p->pagetable == 0){
-    freeproc(p);
-    release(&p->lock);
-    return 0;
-  }
-
   // Set up new context to start executing at forkret,
   // which returns to user space.
   memset(&p->context, 0, sizeof(p->context));
@@ -150,29 +195,134 @@ found:
 }
 
 // free a proc structure and the data hanging from it,
-// including user pages.
+// including user pages if no other thread shares them,
+// and return it to the free list.
+// the kernel stack stays mapped for the next user of p.
 // p->lock must be held.
 static void
 freeproc(struct proc *p)
 {
+  acquirewrite(&pidlock);
+  p->pid = 0;
+  releasewrite(&pidlock);
+  if(p->tg)
+    tgput(p);
   if(p->trapframe)
     kfree((void*)p->trapframe);
   p->trapframe = 0;
-  if(p->pagetable)
-    proc_freepagetable(p->pagetable, p->sz);
-  p->pagetable = 0;
-  p->sz = 0;
-  p->pid = 0;
+  if(p->sampler)
+    kfree((void*)p->sampler);
+  p->sampler = 0;
+  p->sctrace = 0;
   p->parent = 0;
   p->name[0] = 0;
   p->chan = 0;
   p->killed = 0;
   p->xstate = 0;
   p->state = UNUSED;
+
+  acquire(&ptable.lock);
+  p->freenext = ptable.free;
+  ptable.free = p;
+  release(&ptable.lock);
+}
+
+static struct lockclass *tgclass;  // see initlockclass()
+
+// Give p a thread group of its own, with a user page table
+// holding no user memory but p's trapframe at TRAPFRAME.
+// Like trapframes, thread groups take a page each.
+static int
+tgalloc(struct proc *p)
+{
+  struct tgroup *tg;
+
+  if((tg = (struct tgroup*)kalloc()) == 0)
+    return -1;
+  memset(tg, 0, sizeof(*tg));
+  initlockclass(&tg->lock, "tgroup", &tgclass);
+  if((tg->vdso = (struct vdso*)kalloc()) == 0){
+    kfree((void*)tg);
+    return -1;
+  }
+  memset(tg->vdso, 0, PGSIZE);
+  tg->vdso->boottime = boottime;
+  tg->vdso->tickcycles = TICKCYCLES;
+  tg->vdso->timebase = TIMEBASE;
+  tg->vdso->pid = p->pid;
+  p->tg = tg;
+  if((tg->pagetable = proc_pagetable(p)) == 0){
+    kfree((void*)tg->vdso);
+    kfree((void*)tg);
+    p->tg = 0;
+    return -1;
+  }
+  tg->ref = 1;
+  tg->nlive = 1;
+  tg->tfslots = 1;
+
+  p->pagetable = tg->pagetable;
+  p->tfva = TRAPFRAME;
+  return 0;
+}
+
+// Add p to thread group tg, mapping p's trapframe at
+// the first free TFSLOT() in the shared page table.
+static int
+tgjoin(struct proc *p, struct tgroup *tg)
+{
+  int i;
+
+  acquire(&tg->lock);
+  for(i = 0; i < NTHREAD; i++)
+    if((tg->tfslots & (1L << i)) == 0)
+      break;
+  if(i == NTHREAD || mappages(tg->pagetable, TFSLOT(i), PGSIZE,
+                              (uint64)(p->trapframe), PTE_R | PTE_W) < 0){
+    release(&tg->lock);
+    return -1;
+  }
+  tg->tfslots |= 1L << i;
+  tg->ref++;
+  tg->nlive++;
+  // the threads have pids of their own.
+  tg->vdso->pid = 0;
+  release(&tg->lock);
+
+  p->tg = tg;
+  p->pagetable = tg->pagetable;
+  p->tfva = TFSLOT(i);
+  return 0;
+}
+
+// Drop p's reference to its thread group, unmapping
+// p's trapframe. The last reference frees the user
+// page table and memory.
+static void
+tgput(struct proc *p)
+{
+  struct tgroup *tg = p->tg;
+  int last;
+
+  acquire(&tg->lock);
+  tg->tfslots &= ~(1L << ((TRAPFRAME - p->tfva) / PGSIZE));
+  last = (--tg->ref == 0);
+  if(!last)
+    uvmunmap(tg->pagetable, p->tfva, 1, 0);
+  release(&tg->lock);
+
+  if(last){
+    proc_freepagetable(tg->pagetable, tg->sz, p->tfva);
+    kfree((void*)tg->vdso);
+    kfree((void*)tg);
+  }
+  p->tg = 0;
+  p->pagetable = 0;
+  p->tfva = 0;
 }
 
 // Create a user page table for a given process, with no user memory,
-// but with trampoline and trapframe pages.
+// but with trampoline, trapframe and vdso pages.
 pagetable_t
 proc_pagetable(struct proc *p)
 {
@@ -202,16 +352,32 @@ proc_pagetable(struct proc *p)
     return 0;
   }
 
+  // map the thread group's vdso page below the trapframes,
+  // for user code to read.
+  if(mappages(pagetable, VDSO, PGSIZE,
+              (uint64)(p->tg->vdso), PTE_R | PTE_U) < 0){
+    uvmunmap(pagetable, TRAMPOLINE, 1, 0);
+    uvmunmap(pagetable, TRAPFRAME, 1, 0);
+    uvmfree(pagetable, 0);
+    return 0;
+  }
+
   return pagetable;
 }
 
-// Free a process's page table, and free the
-// physical memory it refers to.
+// Free a process's page table, with its last trapframe
+// still mapped at tfva, and free the physical memory it
+// refers to.
 void
-proc_freepagetable(pagetable_t pagetable, uint64 sz)
+proc_freepagetable(pagetable_t pagetable, uint64 sz, uint64 tfva)
 {
   uvmunmap(pagetable, TRAMPOLINE, 1, 0);
-  uvmunmap(pagetable, TRAPFRAME, 1, 0);
+  uvmunmap(pagetable, tfva, 1, 0);
+  uvmunmap(pagetable, VDSO, 1, 0);
+  if(walkaddr(pagetable, RING))
+    uvmunmap(pagetable, RING, 1, 1);
+  if(walkaddr(pagetable, SAMPLES))
+    uvmunmap(pagetable, SAMPLES, 1, 1);
   uvmfree(pagetable, sz);
 }
 
@@ -235,45 +401,83 @@ userinit(void)
   struct proc *p;
 
   p = allocproc();
+  if(p == 0 || tgalloc(p) < 0)
+    panic("userinit");
   initproc = p;
   
   // allocate one user page and copy initcode's instructions
   // and data into it.
   uvmfirst(p->pagetable, initcode, sizeof(initcode));
-  p->sz = PGSIZE;
+  p->tg->sz = PGSIZE;
 
   // prepare for the very first "return" from kernel to user.
   p->trapframe->epc = 0;      // user program counter
   p->trapframe->sp = PGSIZE;  // user stack pointer
 
   safestrcpy(p->name, "initcode", sizeof(p->name));
-  p->cwd = namei("/");
+  p->tg->cwd = namei("/");
 
+  schedfork(p, 0);
   p->state = RUNNABLE;
+  runqput(p);
 
   release(&p->lock);
 }
 
 // Grow or shrink user memory by n bytes.
 // Return 0 on success, -1 on failure.
+// Won't shrink while other threads share the memory,
+// since their harts may still have TLB entries for
+// the pages it would free.
 int
 growproc(int n)
 {
   uint64 sz;
-  struct proc *p = myproc();
+  struct tgroup *tg = myproc()->tg;
 
-  sz = p->sz;
+  acquire(&tg->lock);
+  sz = tg->sz;
   if(n > 0){
-    if((sz = uvmalloc(p->pagetable, sz, sz + n, PTE_W)) == 0) {
+    if(sz + n > MAXUSERVA ||
+       (sz = uvmalloc(tg->pagetable, sz, sz + n, PTE_W)) == 0) {
+      release(&tg->lock);
       return -1;
     }
   } else if(n < 0){
-    sz = uvmdealloc(p->pagetable, sz, sz + n);
+    if(tg->nlive > 1){
+      release(&tg->lock);
+      return -1;
+    }
+    sz = uvmdealloc(tg->pagetable, sz, sz + n);
   }
-  p->sz = sz;
+  tg->sz = sz;
+  release(&tg->lock);
   return 0;
 }
 
+// Grow user memory by n bytes, from the next page boundary,
+// with pages that fork() will share with the child rather
+// than copy. Return the start of the new memory, or -1.
+uint64
+growshared(int n)
+{
+  uint64 sz, start;
+  struct tgroup *tg = myproc()->tg;
+
+  if(n <= 0)
+    return -1;
+  acquire(&tg->lock);
+  start = PGROUNDUP(tg->sz);
+  if(start + n > MAXUSERVA ||
+     (sz = uvmalloc(tg->pagetable, start, start + n, PTE_W | PTE_S)) == 0){
+    release(&tg->lock);
+    return -1;
+  }
+  tg->sz = sz;
+  release(&tg->lock);
+  return start;
+}
+
 // Create a new process, copying the parent.
 // Sets up child kernel stack to return as if from fork() system call.
 int
@@ -287,14 +491,29 @@ fork(void)
   if((np = allocproc()) == 0){
     return -1;
   }
+  if(tgalloc(np) < 0){
+    freeproc(np);
+    release(&np->lock);
+    return -1;
+  }
 
   // Copy user memory from parent to child.
-  if(uvmcopy(p->pagetable, np->pagetable, p->sz) < 0){
+  // hold the lock so other threads can't resize it meanwhile.
+  acquire(&p->tg->lock);
+  if(uvmcopy(p->pagetable, np->pagetable, p->tg->sz) < 0){
+    release(&p->tg->lock);
     freeproc(np);
     release(&np->lock);
     return -1;
   }
-  np->sz = p->sz;
+  np->tg->sz = p->tg->sz;
+
+  // increment reference counts on open file descriptors.
+  for(i = 0; i < NOFILE; i++)
+    if(p->tg->ofile[i])
+      np->tg->ofile[i] = filedup(p->tg->ofile[i]);
+  np->tg->cwd = idup(p->tg->cwd);
+  release(&p->tg->lock);
 
   // copy saved user registers.
   *(np->trapframe) = *(p->trapframe);
@@ -302,13 +521,9 @@ fork(void)
   // Cause fork to return 0 in the child.
   np->trapframe->a0 = 0;
 
-  // increment reference counts on open file descriptors.
-  for(i = 0; i < NOFILE; i++)
-    if(p->ofile[i])
-      np->ofile[i] = filedup(p->ofile[i]);
-  np->cwd = idup(p->cwd);
-
   safestrcpy(np->name, p->name, sizeof(p->name));
+  np->sctrace = p->sctrace;
+  schedfork(np, p);
 
   pid = np->pid;
 
@@ -320,11 +535,58 @@ fork(void)
 
   acquire(&np->lock);
   np->state = RUNNABLE;
+  runqput(np);
   release(&np->lock);
 
   return pid;
 }
 
+// Create a thread: a new process sharing the caller's
+// address space, open files and current directory,
+// that starts by calling fn(arg) on the user stack
+// whose top is at stack.
+// Returns the new thread's pid, its thread id.
+int
+clone(uint64 fn, uint64 arg, uint64 stack)
+{
+  int tid;
+  struct proc *np;
+  struct proc *p = myproc();
+
+  if((np = allocproc()) == 0){
+    return -1;
+  }
+  if(tgjoin(np, p->tg) < 0){
+    freeproc(np);
+    release(&np->lock);
+    return -1;
+  }
+
+  *(np->trapframe) = *(p->trapframe);
+  np->trapframe->epc = fn;
+  np->trapframe->a0 = arg;
+  np->trapframe->sp = stack & ~0xfL; // riscv sp must be 16-byte aligned
+
+  safestrcpy(np->name, p->name, sizeof(p->name));
+  np->sctrace = p->sctrace;
+  schedfork(np, p);
+
+  tid = np->pid;
+
+  release(&np->lock);
+
+  acquire(&wait_lock);
+  np->parent = p;
+  release(&wait_lock);
+
+  acquire(&np->lock);
+  np->state = RUNNABLE;
+  runqput(np);
+  release(&np->lock);
+
+  return tid;
+}
+
 // Pass p's abandoned children to init.
 // Caller must hold wait_lock.
 void
@@ -332,7 +594,7 @@ reparent(struct proc *p)
 {
   struct proc *pp;
 
-  for(pp = proc; pp < &proc[NPROC]; pp++){
+  for(pp = allproc; pp; pp = pp->allnext){
     if(pp->parent == p){
       pp->parent = initproc;
       wakeup(initproc);
@@ -347,23 +609,30 @@ void
 exit(int status)
 {
   struct proc *p = myproc();
+  struct tgroup *tg = p->tg;
+  int last;
 
   if(p == initproc)
     panic("init exiting");
 
-  // Close all open files.
-  for(int fd = 0; fd < NOFILE; fd++){
-    if(p->ofile[fd]){
-      struct file *f = p->ofile[fd];
-      fileclose(f);
-      p->ofile[fd] = 0;
+  // The last thread out closes all open files.
+  acquire(&tg->lock);
+  last = (--tg->nlive == 0);
+  release(&tg->lock);
+  if(last){
+    for(int fd = 0; fd < NOFILE; fd++){
+      if(tg->ofile[fd]){
+        struct file *f = tg->ofile[fd];
+        fileclose(f);
+        tg->ofile[fd] = 0;
+      }
     }
-  }
 
-  begin_op();
-  iput(p->cwd);
-  end_op();
-  p->cwd = 0;
+    begin_op();
+    iput(tg->cwd);
+    end_op();
+    tg->cwd = 0;
+  }
 
   acquire(&wait_lock);
 
@@ -385,13 +654,16 @@ exit(int status)
   panic("zombie exit");
 }
 
-// Wait for a child process to exit and return its pid.
-// Return -1 if this process has no children.
-int
-wait(uint64 addr)
+// Wait for a child to exit and return its pid, copying its
+// exit status to addr. The children waited for are threads
+// created by clone() if threads is set, other processes if
+// not; either just the one with the given pid, or any if
+// pid is 0. Return -1 if there are no such children.
+static int
+reap(int pid, uint64 addr, int threads)
 {
   struct proc *pp;
-  int havekids, pid;
+  int havekids;
   struct proc *p = myproc();
 
   acquire(&wait_lock);
@@ -399,8 +671,9 @@ wait(uint64 addr)
   for(;;){
     // Scan through table looking for exited children.
     havekids = 0;
-    for(pp = proc; pp < &proc[NPROC]; pp++){
-      if(pp->parent == p){
+    for(pp = allproc; pp; pp = pp->allnext){
+      if(pp->parent == p && (pp->tg == p->tg) == threads &&
+         (pid == 0 || pp->pid == pid)){
         // make sure the child isn't still in exit() or swtch().
         acquire(&pp->lock);
 
@@ -434,13 +707,31 @@ wait(uint64 addr)
   }
 }
 
+// Wait for a child process to exit and return its pid.
+// Return -1 if this process has no children.
+int
+wait(uint64 addr)
+{
+  return reap(0, addr, 0);
+}
+
+// Wait for thread tid, or any thread if tid is 0, created
+// by this one with clone(), to exit, and return its tid.
+int
+join(int tid, uint64 addr)
+{
+  return reap(tid, addr, 1);
+}
+
 // Per-CPU process scheduler.
 // Each CPU calls scheduler() after setting itself up.
 // Scheduler never returns.  It loops, doing:
-//  - choose a process to run.
+//  - take the next process to run off the run queue (sched.c).
 //  - swtch to start running that process.
-//  - eventually that process transfers control
-//    via swtch back to the scheduler.
+//  - processes mostly switch straight to one another in
+//    sched(); only when nothing else is runnable does one
+//    transfer control via swtch back to the scheduler,
+//    which then waits in idle() for more work.
 void
 scheduler(void)
 {
@@ -448,31 +739,61 @@ scheduler(void)
   struct cpu *c = mycpu();
   
   c->proc = 0;
+  c->online = 1;
   for(;;){
     // Avoid deadlock by ensuring that devices can interrupt.
     intr_on();
 
-    for(p = proc; p < &proc[NPROC]; p++) {
-      acquire(&p->lock);
-      if(p->state == RUNNABLE) {
-        // Switch to chosen process.  It is the process's job
-        // to release its lock and then reacquire it
-        // before jumping back to us.
-        p->state = RUNNING;
-        c->proc = p;
-        swtch(&c->context, &p->context);
-
-        // Process is done running for now.
-        // It should have changed its p->state before coming back.
-        c->proc = 0;
-      }
+    if((p = runqget()) == 0){
+      idle();
+      continue;
+    }
+
+    acquire(&p->lock);
+    if(p->state != RUNNABLE){
       release(&p->lock);
+      continue;
     }
+
+    // Switch to chosen process.  It is the process's job
+    // to release its lock and then reacquire it
+    // before jumping back to us.
+    p->state = RUNNING;
+    TRACEPOINT(TR_SWITCH, p->pid, 0);
+    c->proc = p;
+    kvmsync();
+    swtch(&c->context, &p->context);
+
+    // Some process, not necessarily p, is done running for now.
+    // It changed its p->state, and left itself in c->prev
+    // with its lock held, before coming back.
+    c->proc = 0;
+    switchdone();
   }
 }
 
-// Switch to scheduler.  Must hold only p->lock
-// and have changed proc->state. Saves and restores
+// Called on the far side of every swtch() between a process
+// and another process or the scheduler: release the lock of
+// the process that switched away, which sched() left in
+// mycpu()->prev.
+static void
+switchdone(void)
+{
+  struct cpu *c = mycpu();
+
+  if(c->prev){
+    release(&c->prev->lock);
+    c->prev = 0;
+  }
+}
+
+// Switch to the next process.  Must hold only p->lock
+// and have changed proc->state. The next process is
+// chosen here, and switched to directly, with its lock
+// held the way scheduler() would; the scheduler thread
+// is only used when nothing else is runnable. If p is
+// RUNNABLE and still the best choice, it just keeps
+// the CPU. Saves and restores
 // intena because intena is a property of this
 // kernel thread, not this CPU. It should
 // be proc->intena and proc->noff, but that would
@@ -482,19 +803,41 @@ void
 sched(void)
 {
   int intena;
-  struct proc *p = myproc();
+  struct proc *p = myproc(), *np;
+  struct cpu *c = mycpu();
 
   if(!holding(&p->lock))
     panic("sched p->lock");
-  if(mycpu()->noff != 1)
+  if(c->noff != 1)
     panic("sched locks");
   if(p->state == RUNNING)
     panic("sched running");
   if(intr_get())
     panic("sched interruptible");
 
-  intena = mycpu()->intena;
-  swtch(&p->context, &mycpu()->context);
+  if((np = schedswitch(p)) == p){
+    p->state = RUNNING;
+    return;
+  }
+
+  intena = c->intena;
+  c->prev = p;
+  TRACEPOINT(TR_SWITCH, np ? np->pid : 0, p->state);
+  if(np){
+    // np came off the run queue before p went back on,
+    // so whoever holds np->lock isn't waiting for ours.
+    acquire(&np->lock);
+    np->state = RUNNING;
+    c->proc = np;
+    kvmsync();
+    swtch(&p->context, &np->context);
+  } else {
+    swtch(&p->context, &c->context);
+  }
+
+  // running p again, perhaps on another CPU, with
+  // p->lock held by whoever switched to us.
+  switchdone();
   mycpu()->intena = intena;
 }
 
@@ -516,7 +859,9 @@ forkret(void)
 {
   static int first = 1;
 
-  // Still holding p->lock from scheduler.
+  // Still holding p->lock from scheduler() or sched(),
+  // and perhaps the lock of the process that switched to us.
+  switchdone();
   release(&myproc()->lock);
 
   if (first) {
@@ -563,22 +908,45 @@ sleep(void *chan, struct spinlock *lk)
 
 // Wake up all processes sleeping on chan.
 // Must be called without any p->lock.
+// If a process is doing the waking, remember the last one
+// it woke: should it block next, sched() can hand that
+// process the CPU directly.
 void
 wakeup(void *chan)
 {
-  struct proc *p;
+  struct proc *p, *me = myproc();
 
-  for(p = proc; p < &proc[NPROC]; p++) {
-    if(p != myproc()){
+  for(p = allproc; p; p = p->allnext) {
+    if(p != me){
       acquire(&p->lock);
       if(p->state == SLEEPING && p->chan == chan) {
         p->state = RUNNABLE;
+        runqput(p);
+        if(me)
+          me->wakee = p;
       }
       release(&p->lock);
     }
   }
 }
 
+// Wake p if it is sleeping on chan.
+// Must be called without p->lock.
+void
+wakeproc(struct proc *p, void *chan)
+{
+  struct proc *me = myproc();
+
+  acquire(&p->lock);
+  if(p->state == SLEEPING && p->chan == chan) {
+    p->state = RUNNABLE;
+    runqput(p);
+    if(me && me != p)
+      me->wakee = p;
+  }
+  release(&p->lock);
+}
+
 // Kill the process with the given pid.
 // The victim won't exit until it tries to return
 // to user space (see usertrap() in trap.c).
@@ -587,20 +955,44 @@ kill(int pid)
 {
   struct proc *p;
 
-  for(p = proc; p < &proc[NPROC]; p++){
-    acquire(&p->lock);
-    if(p->pid == pid){
-      p->killed = 1;
-      if(p->state == SLEEPING){
-        // Wake process from sleep().
-        p->state = RUNNABLE;
-      }
-      release(&p->lock);
-      return 0;
-    }
+  if(pid == 0 || (p = lookuppid(pid)) == 0)
+    return -1;
+  acquire(&p->lock);
+  if(p->pid != pid){
+    // it exited meanwhile; pids aren't reused.
     release(&p->lock);
+    return -1;
   }
-  return -1;
+  p->killed = 1;
+  if(p->state == SLEEPING){
+    // Wake process from sleep().
+    p->state = RUNNABLE;
+    runqput(p);
+  } else if(p->state == RUNNING){
+    // make sure it traps, to see it has been killed.
+    schedkick(p);
+  }
+  release(&p->lock);
+  return 0;
+}
+
+// Return the process with the given pid, or the
+// caller if pid is 0, with p->lock held.
+// Returns 0 if there is no such process.
+struct proc*
+findproc(int pid)
+{
+  struct proc *p;
+
+  if(pid == 0)
+    pid = myproc()->pid;
+  if((p = lookuppid(pid)) == 0)
+    return 0;
+  acquire(&p->lock);
+  if(p->pid == pid && p->state != UNUSED)
+    return p;
+  release(&p->lock);
+  return 0;
 }
 
 void
@@ -652,9 +1044,51 @@ either_copyin(void *dst, int user_src, uint64 src, uint64 len)
   }
 }
 
+// Copy statistics for up to n processes into the struct
+// procstat array at user address addr.
+// Returns the number of processes copied, or -1.
+int
+procstat(uint64 addr, int n)
+{
+  struct procstat ps;
+  struct proc *p;
+  int i = 0;
+
+  for(p = allproc; p && i < n; p = p->allnext){
+    acquire(&p->lock);
+    if(p->state == UNUSED){
+      release(&p->lock);
+      continue;
+    }
+    ps.pid = p->pid;
+    ps.state = p->state;
+    ps.nice = p->nice;
+    ps.hart = p->hart;
+    ps.sz = p->tg ? p->tg->sz : 0;
+    ps.utime = p->utime;
+    if(p->state == RUNNING && p != myproc()){
+      // a process alone on its hart, with the ticks stopped,
+      // is charged only when it traps; count the time since
+      // as user time, where such long stretches are spent.
+      ps.utime += r_time() - p->cpustamp;
+    }
+    ps.stime = p->stime;
+    ps.wait = p->waittime;
+    ps.nvcsw = p->nvcsw;
+    ps.nivcsw = p->nivcsw;
+    safestrcpy(ps.name, p->name, sizeof(ps.name));
+    release(&p->lock);
+    if(copyout(myproc()->pagetable, addr + i*sizeof(ps), (char*)&ps, sizeof(ps)) < 0)
+      return -1;
+    i++;
+  }
+  return i;
+}
+
 // Print a process listing to console.  For debugging.
 // Runs when user types ^P on console.
-// No lock to avoid wedging a stuck machine further.
+// Takes only the pid lock for reading, not the procs'
+// locks, to avoid wedging a stuck machine further.
 void
 procdump(void)
 {
@@ -670,8 +1104,9 @@ procdump(void)
   char *state;
 
   printf("\n");
-  for(p = proc; p < &proc[NPROC]; p++){
-    if(p->state == UNUSED)
+  acquireread(&pidlock);
+  for(p = allproc; p; p = p->allnext){
+    if(p->pid == 0)
       continue;
     if(p->state >= 0 && p->state < NELEM(states) && states[p->state])
       state = states[p->state];
@@ -680,6 +1115,10 @@ procdump(void)
     printf("%d %s %s", p->pid, state, p->name);
     printf("\n");
   }
+  releaseread(&pidlock);
+  for(int i = 0; i < NCPU; i++)
+    if(cpus[i].online)
+      printf("hart %d: idle %d ticks\n", i, (int)(cpus[i].idletime / TICKCYCLES));
 }
 
 void print_registry(uint64 registry, int number)
@@ -712,8 +1151,11 @@ int dump2(int pid, int register_num, uint64 return_value_addr){
   
   struct proc *p;
   struct proc *requested_proc = 0;
-  for (p = proc; p < &proc[NPROC]; p++){
-    if (p-> state == UNUSED) continue;
+  // the pid lock keeps the process, and its trapframe,
+  // from being freed while we read it.
+  acquireread(&pidlock);
+  for (p = allproc; p; p = p->allnext){
+    if (p->pid == 0) continue;
     if (p->pid == pid){
       requested_proc = p;
       break;
@@ -721,10 +1163,12 @@ int dump2(int pid, int register_num, uint64 return_value_addr){
   }
 
   if (requested_proc == 0){
+    releaseread(&pidlock);
     return -2;
   }
   
-  if (requested_proc->pid != cur_proc->pid && requested_proc->parent->pid != cur_proc->pid){
+  if (requested_proc != cur_proc && requested_proc->parent != cur_proc){
+    releaseread(&pidlock);
     return -1;
   }
 
@@ -761,6 +1205,7 @@ int dump2(int pid, int register_num, uint64 return_value_addr){
       register_value = requested_proc->trapframe->s11;
       break;
   }
+  releaseread(&pidlock);
 
   int res = copyout(cur_proc->pagetable, return_value_addr, (char *) (&register_value), 8);
 
@@ -770,3 +1215,68 @@ int dump2(int pid, int register_num, uint64 return_value_addr){
 
   return 0;
 }
+
+// User register x<i>, for 1 <= i < 32, as saved in tf.
+// The trapframe holds x1-x31 in order, starting at ra.
+uint64
+trapframereg(struct trapframe *tf, int i)
+{
+  return (&tf->ra)[i - 1];
+}
+
+// Snapshot the registers selected by mask of each of the n
+// processes whose pids are in the int array at user address
+// pids, into the struct regset array at user address addr,
+// each taken under the process's lock. Only the caller and
+// its children may be read. The process must not be running
+// for its registers to be current: they are saved when it
+// traps into the kernel.
+// Returns the number of regsets filled in, at most NREGSET,
+// or -1.
+int
+regsnap(uint64 pids, int n, uint64 mask, uint64 addr)
+{
+  struct proc *me = myproc(), *p;
+  struct regset *rs;
+  int pid[NREGSET], i, r;
+
+  if(n < 0)
+    return -1;
+  if(n > NREGSET)
+    n = NREGSET;
+  if(copyin(me->pagetable, (char*)pid, pids, n * sizeof(int)) < 0)
+    return -1;
+  if((rs = (struct regset*)kalloc()) == 0)
+    return -1;
+  memset(rs, 0, n * sizeof(*rs));
+  for(i = 0; i < n; i++){
+    rs[i].pid = pid[i];
+    rs[i].err = -1;
+  }
+
+  // one pass over the processes for all the pids.
+  for(p = allproc; p; p = p->allnext){
+    acquire(&p->lock);
+    for(i = 0; i < n; i++){
+      if(p->pid != pid[i] || p->state == UNUSED || p->trapframe == 0)
+        continue;
+      if(p != me && p->parent != me){
+        rs[i].err = -2;
+        continue;
+      }
+      for(int j = 1; j < 32; j++)
+        if(mask & (1L << j))
+          rs[i].x[j] = trapframereg(p->trapframe, j);
+      if(mask & (1L << REG_PC))
+        rs[i].x[REG_PC] = p->trapframe->epc;
+      rs[i].err = 0;
+    }
+    release(&p->lock);
+  }
+
+  r = n;
+  if(copyout(me->pagetable, addr, (char*)rs, n * sizeof(*rs)) < 0)
+    r = -1;
+  kfree((void*)rs);
+  return r;
+}
@@ -24,6 +24,13 @@ struct cpu {
   struct context context;     // swtch() here to enter scheduler().
   int noff;                   // Depth of push_off() nesting.
   int intena;                 // Were interrupts enabled before push_off()?
+  struct proc *prev;          // Switched away from; its lock is still held.
+  int online;                 // Has this CPU entered scheduler()?
+  uint64 idletime;            // time CSR cycles spent idle in wfi
+  uint64 nipi;                // IPIs received
+  uint64 nexttick;            // time CSR of the next scheduler tick, or -1 if stopped
+  uint64 ntick;               // scheduler ticks taken
+  uint kstackgen;             // kstackgen when this hart last flushed its TLB
 };
 
 extern struct cpu cpus[NCPU];
@@ -81,6 +88,25 @@ struct trapframe {
 
 enum procstate { UNUSED, USED, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
+// State shared by the threads of a process: a process
+// created by fork() gets a new one, a thread created by
+// clone() shares its creator's.
+struct tgroup {
+  struct spinlock lock;
+  int ref;                     // procs using it, live or zombie
+  int nlive;                   // procs that haven't exited
+
+  // lock must be held to change these:
+  pagetable_t pagetable;       // User page table
+  uint64 sz;                   // Size of process memory (bytes)
+  uint64 tfslots;              // TFSLOT()s with a trapframe mapped
+  struct vdso *vdso;           // mapped at VDSO
+  struct ring *ring;           // mapped at RING, or 0
+  int ringbusy;                // in ringenter()?
+  struct file *ofile[NOFILE];  // Open files
+  struct inode *cwd;           // Current directory
+};
+
 // Per-process state
 struct proc {
   struct spinlock lock;
@@ -91,17 +117,47 @@ struct proc {
   int killed;                  // If non-zero, have been killed
   int xstate;                  // Exit status to be returned to parent's wait
   int pid;                     // Process ID
+  struct samplering *sampler;  // Being sampled into, see sample.c
+  uint64 samplemask;           // Registers to sample
 
   // wait_lock must be held when using this:
   struct proc *parent;         // Parent process
 
+  // sched.c's runq.lock must be held when using these:
+  struct proc *rqnext;         // Next on run queue
+  int level;                   // MLFQ level, 0 is the highest priority
+  int slice;                   // Ticks used at this level
+  uint boostgen;               // Priority boosts seen
+  int nice;                    // NICE_MIN (favoured) to NICE_MAX
+  int rqidx;                   // Index in the fair class's heap
+  uint64 vruntime;             // Weighted running time, fair class
+  uint64 runstart;             // time CSR when last charged for CPU
+  uint64 affinity;             // Harts it may run on, one bit each
+  int onrq;                    // On the run queue?
+  uint64 queuedat;             // time CSR when last queued
+  uint64 waittime;             // Cycles spent queued
+  int hart;                    // Hart it last ran on
+  int donated;                 // Ticks left of a slice handed over on wakeup
+
+  struct proc *allnext;        // Next in allproc; set once at creation
+  struct proc *freenext;       // Next on free list (ptable.lock)
+
   // these are private to the process, so p->lock need not be held.
   uint64 kstack;               // Virtual address of kernel stack
-  uint64 sz;                   // Size of process memory (bytes)
-  pagetable_t pagetable;       // User page table
+  struct tgroup *tg;           // Address space, files and cwd
+  pagetable_t pagetable;       // tg->pagetable, for convenience
   struct trapframe *trapframe; // data page for trampoline.S
+  uint64 tfva;                 // User virtual address of trapframe
   struct context context;      // swtch() here to run process
-  struct file *ofile[NOFILE];  // Open files
-  struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
+  struct proc *wakee;          // Last process this one woke, for sched()
+  uint64 sctrace;              // System calls to trace, 1 << number
+
+  // CPU accounting, in time CSR cycles, kept by the process
+  // itself as it enters and leaves the kernel and the CPU.
+  uint64 cpustamp;             // time CSR at the last update
+  uint64 utime;                // Time running in user space
+  uint64 stime;                // Time running in the kernel
+  uint64 nvcsw;                // Switches away on blocking
+  uint64 nivcsw;               // Switches away on preemption
 };
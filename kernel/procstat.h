@@ -0,0 +1,15 @@
+// Per-process statistics, filled in by the procstat() system call.
+// Times are in time CSR cycles, TICKCYCLES to a tick.
+struct procstat {
+  int pid;
+  int state;       // enum procstate
+  int nice;
+  int hart;        // Hart it last ran on
+  uint64 sz;       // Size of process memory (bytes)
+  uint64 utime;    // Running in user space
+  uint64 stime;    // Running in the kernel
+  uint64 wait;     // RUNNABLE but waiting for a hart
+  uint64 nvcsw;    // Switches away because it blocked
+  uint64 nivcsw;   // Switches away because it was preempted
+  char name[16];
+};
@@ -0,0 +1,24 @@
+// A process's saved user registers, filled in by the
+// regsnap() system call. x[i] is register xi, except x[0],
+// which is the pc; bit i of regsnap()'s mask selects x[i],
+// and the rest are 0.
+struct regset {
+  int pid;
+  int err;         // 0, or -1 if no such process, -2 if not permitted
+  uint64 x[32];
+};
+
+#define NREGSET 15   // most regsets per regsnap() call; they fit a page
+
+// register numbers, for x[] and the mask.
+#define REG_PC     0
+#define REG_RA     1
+#define REG_SP     2
+#define REG_S0     8
+#define REG_S1     9
+#define REG_A(n)   (10 + (n))   // a0-a7
+#define REG_S(n)   (16 + (n))   // s2-s11
+
+#define REGMASK_A  (0xffL << REG_A(0))       // a0-a7
+#define REGMASK_S  (0x3ffL << REG_S(2))      // s2-s11, as dump2() reads
+#define REGMASK_ALL 0xffffffffL
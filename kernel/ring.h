@@ -0,0 +1,38 @@
+// A submission and completion ring, in a page shared by user
+// code and the kernel, set up by ringsetup(). User code fills
+// in sq[sqtail % NRING] and advances sqtail for each operation
+// it wants done; ringenter() does them in order, advancing
+// sqhead, and posts each one's result at cq[cqtail % NRING].
+// User code consumes results by advancing cqhead. The indexes
+// only ever increase, wrapping at 2^32.
+#define NRING 64
+
+// operations
+#define RING_READ  1   // read(fd, addr, n)
+#define RING_WRITE 2   // write(fd, addr, n)
+#define RING_OPEN  3   // open(addr, omode)
+#define RING_CLOSE 4   // close(fd)
+
+struct sqe {
+  int op;
+  int fd;
+  int n;
+  int omode;
+  uint64 addr;
+  uint64 data;      // copied to the completion, for user code
+};
+
+struct cqe {
+  uint64 data;      // from the submission
+  int res;          // what the system call would have returned
+  int pad;
+};
+
+struct ring {
+  uint sqhead;      // advanced by the kernel
+  uint sqtail;      // advanced by user code
+  uint cqhead;      // advanced by user code
+  uint cqtail;      // advanced by the kernel
+  struct sqe sq[NRING];
+  struct cqe cq[NRING];
+};
@@ -0,0 +1,101 @@
+// Reader-writer spin locks, for tables that are looked up
+// far more often than they change.
+//
+// A cpu must not take the read lock again while holding
+// it: a writer waiting in between would hold off the second
+// acquisition, and wait itself for the first to go.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "spinlock.h"
+#include "rwspinlock.h"
+#include "riscv.h"
+#include "proc.h"
+#include "defs.h"
+
+void
+initrwlock(struct rwspinlock *lk, char *name)
+{
+  lk->name = name;
+  lk->readers = 0;
+  lk->writer = 0;
+  lk->wwait = 0;
+  lk->cpu = 0;
+}
+
+// Acquire the lock for reading, shared with other readers.
+// Spins while a writer holds the lock or waits for it.
+void
+acquireread(struct rwspinlock *lk)
+{
+  push_off(); // disable interrupts to avoid deadlock.
+  if(holdingwrite(lk))
+    panic("acquireread");
+
+  for(;;){
+    // wait for writers to finish, then count this reader
+    // in, and back out if a writer got in first.
+    while(__atomic_load_n(&lk->wwait, __ATOMIC_ACQUIRE) ||
+          __atomic_load_n(&lk->writer, __ATOMIC_ACQUIRE))
+      ;
+    __sync_fetch_and_add(&lk->readers, 1);
+    if(__atomic_load_n(&lk->writer, __ATOMIC_ACQUIRE) == 0)
+      break;
+    __sync_fetch_and_sub(&lk->readers, 1);
+  }
+
+  // keep the reads of the table after the acquisition.
+  __sync_synchronize();
+}
+
+void
+releaseread(struct rwspinlock *lk)
+{
+  if(lk->readers == 0)
+    panic("releaseread");
+  __sync_synchronize();
+  __sync_fetch_and_sub(&lk->readers, 1);
+  pop_off();
+}
+
+// Acquire the lock for writing, alone.
+// Stops new readers, then waits for the ones inside to leave.
+void
+acquirewrite(struct rwspinlock *lk)
+{
+  push_off();
+  if(holdingwrite(lk))
+    panic("acquirewrite");
+
+  __sync_fetch_and_add(&lk->wwait, 1);
+  while(__sync_lock_test_and_set(&lk->writer, 1) != 0)
+    ;
+  __sync_fetch_and_sub(&lk->wwait, 1);
+  // a reader counts itself in before looking at writer,
+  // so any that missed it are counted here.
+  while(__atomic_load_n(&lk->readers, __ATOMIC_ACQUIRE) != 0)
+    ;
+
+  __sync_synchronize();
+  lk->cpu = mycpu();
+}
+
+void
+releasewrite(struct rwspinlock *lk)
+{
+  if(!holdingwrite(lk))
+    panic("releasewrite");
+  lk->cpu = 0;
+  __sync_synchronize();
+  __sync_lock_release(&lk->writer);
+  pop_off();
+}
+
+// Is this cpu holding the lock for writing?
+// Interrupts must be off.
+int
+holdingwrite(struct rwspinlock *lk)
+{
+  return lk->writer && lk->cpu == mycpu();
+}
@@ -0,0 +1,12 @@
+// Reader-writer spin lock: any number of readers, or one
+// writer. Readers hold off while a writer is waiting, so
+// a stream of readers can't starve writers.
+struct rwspinlock {
+  uint readers;      // Readers holding the lock
+  uint writer;       // Is a writer holding it?
+  uint wwait;        // Writers waiting for it
+
+  // For debugging:
+  char *name;        // Name of lock.
+  struct cpu *cpu;   // The cpu holding it for writing.
+};
@@ -0,0 +1,134 @@
+//
+// Sampling a process's registers on the timer tick.
+//
+// sampleattach() maps a struct samplering into the caller
+// and hangs it on the target process, whose timer ticks
+// then record its pc and chosen registers there; see
+// sample.h. The page has two references, the mapping and
+// the target's, so either side may go away first.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sample.h"
+#include "defs.h"
+
+// Start sampling process pid, the caller or a child of it,
+// on its timer ticks, recording up to NSAMPLEREG of the
+// registers selected by mask, numbered as in regset.h,
+// lowest first. Only one process at a time can be sampled
+// by a given process, and into a given process.
+// Returns the address of the struct samplering, or -1.
+uint64
+sampleattach(int pid, uint64 mask)
+{
+  struct proc *me = myproc(), *p;
+  struct tgroup *tg = me->tg;
+  struct samplering *r;
+  int i, n;
+
+  if((r = (struct samplering*)kalloc()) == 0)
+    return -1;
+  memset(r, 0, PGSIZE);
+  r->pid = pid ? pid : me->pid;
+  for(i = 1, n = 0; i < 32 && n < NSAMPLEREG; i++)
+    if(mask & (1L << i))
+      r->regs[n++] = i;
+  for(; n < NSAMPLEREG; n++)
+    r->regs[n] = -1;
+
+  acquire(&tg->lock);
+  if(walkaddr(tg->pagetable, SAMPLES) ||
+     mappages(tg->pagetable, SAMPLES, PGSIZE, (uint64)r, PTE_R | PTE_W | PTE_U) < 0){
+    release(&tg->lock);
+    kfree((void*)r);
+    return -1;
+  }
+  release(&tg->lock);
+
+  if((p = findproc(pid)) != 0){
+    if((p == me || p->parent == me) && p->sampler == 0){
+      kref((void*)r);
+      p->sampler = r;
+      p->samplemask = mask & ~1L;
+      // a hart that stopped its ticks for p must restart them.
+      if(p->state == RUNNING && p != me)
+        schedkick(p);
+      release(&p->lock);
+      return SAMPLES;
+    }
+    release(&p->lock);
+  }
+
+  acquire(&tg->lock);
+  uvmunmap(tg->pagetable, SAMPLES, 1, 1);
+  release(&tg->lock);
+  return -1;
+}
+
+// Stop the sampling that the caller's sampleattach() started.
+int
+sampledetach(void)
+{
+  struct proc *p;
+  struct tgroup *tg = myproc()->tg;
+  struct samplering *r;
+
+  acquire(&tg->lock);
+  r = (struct samplering*)walkaddr(tg->pagetable, SAMPLES);
+  release(&tg->lock);
+  if(r == 0)
+    return -1;
+
+  if((p = findproc(r->pid)) != 0){
+    if(p->sampler == r){
+      p->sampler = 0;
+      kfree((void*)r);
+    }
+    release(&p->lock);
+  }
+
+  acquire(&tg->lock);
+  uvmunmap(tg->pagetable, SAMPLES, 1, 1);
+  release(&tg->lock);
+  return 0;
+}
+
+// Record a sample of p, which is running on this hart and
+// has just taken a timer interrupt, in user space or, if
+// kernel is set, in the kernel.
+void
+sample(struct proc *p, int kernel)
+{
+  struct samplering *r;
+  struct sample *s;
+  int i, n;
+
+  acquire(&p->lock);
+  if((r = p->sampler) == 0){
+    release(&p->lock);
+    return;
+  }
+  if(r->head - r->tail >= NSAMPLE){
+    r->dropped++;
+    release(&p->lock);
+    return;
+  }
+  s = &r->s[r->head % NSAMPLE];
+  s->time = r_time();
+  s->pc = p->trapframe->epc;
+  s->kernel = kernel;
+  s->hart = cpuid();
+  // the registers come from p->samplemask, not the
+  // page, which the profiler can write.
+  for(i = 1, n = 0; i < 32 && n < NSAMPLEREG; i++)
+    if(p->samplemask & (1L << i))
+      s->reg[n++] = trapframereg(p->trapframe, i);
+  __sync_synchronize();
+  r->head++;
+  release(&p->lock);
+}
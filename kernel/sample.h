@@ -0,0 +1,25 @@
+// Samples of a process's user registers, taken on each timer
+// tick while it runs, into a ring in a page that
+// sampleattach() maps into the profiler. The kernel fills
+// s[head % NSAMPLE] and advances head; the profiler reads
+// samples up to head and advances tail. The indexes only
+// ever increase, wrapping at 2^32.
+#define NSAMPLE 64
+#define NSAMPLEREG 4
+
+struct sample {
+  uint64 time;               // time CSR
+  uint64 pc;                 // user pc
+  uint64 reg[NSAMPLEREG];    // registers chosen by sampleattach()
+  int kernel;                // in the kernel, for a system call or trap at pc?
+  int hart;
+};
+
+struct samplering {
+  uint head;                 // advanced by the kernel
+  uint tail;                 // advanced by the profiler
+  uint dropped;              // samples lost to a full ring
+  int pid;                   // process being sampled
+  int regs[NSAMPLEREG];      // register numbers, as in regset.h, or -1
+  struct sample s[NSAMPLE];
+};
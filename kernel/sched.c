@@ -0,0 +1,836 @@
+//
+// Scheduling policy.
+//
+// RUNNABLE processes wait on the run queue until scheduler()
+// takes one off with runqget(). How they are ordered, and when
+// a running process should give way, is up to the scheduling
+// class chosen at build time with make SCHED=rr, mlfq or fair:
+//
+// rr: one FIFO queue; every timer tick preempts.
+//
+// mlfq: a multi-level feedback queue. scheduler() always runs
+// the head of the highest-priority (lowest-numbered) non-empty
+// queue. A process that uses up its level's allotment of timer
+// ticks, whether in one go or across several sleeps, moves down
+// a level; every BOOSTTICKS ticks all processes move back to
+// the top, so CPU-bound jobs can't starve. nice values above
+// zero keep a process out of the upper levels; negative ones
+// lengthen its slices.
+//
+// fair: proportional share. Each process accumulates virtual
+// runtime, its real running time scaled down by a weight derived
+// from its nice value, and the process with the least virtual
+// runtime runs next. A process with twice the weight gets twice
+// the CPU of a competing one.
+//
+// A process only runs on the harts in its affinity mask
+// (see setaffinity()); each hart picks the best queued
+// process that it is allowed to run.
+//
+// Whatever the class, a process that blocks right after waking
+// another (a pipe writer waiting for the reply, say) hands its
+// CPU straight to the process it woke, along with whatever is
+// left of its slice, unless the handoff is turned off with
+// sethandoff().
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "defs.h"
+
+// ticks a process may run at each level before demotion.
+static int mlfqslice[NMLFQ] = { 1, 2, 4 };
+
+// fair class weight of each nice value, NICE_MIN first.
+// neighbouring values differ by about 25% in CPU share.
+static int niceweight[NICE_MAX-NICE_MIN+1] = {
+  88761, 71755, 56483, 46273, 36291,
+  29154, 23254, 18705, 14949, 11916,
+  9548, 7620, 6100, 4904, 3906,
+  3121, 2501, 1991, 1586, 1277,
+  1024, 820, 655, 526, 423,
+  335, 272, 215, 172, 137,
+  110, 87, 70, 56, 45,
+  36, 29, 23, 18, 15,
+};
+#define NICE0WEIGHT 1024
+
+// how far, in weighted time CSR cycles, a fair process may get
+// ahead of the least-served runnable one before it is preempted.
+#define FAIRGRAN (TICKCYCLES/2)
+
+#define ALLHARTS ((1L << NCPU) - 1)
+
+#ifndef SCHEDCLASS
+#define SCHEDCLASS mlfqclass
+#endif
+
+struct {
+  struct spinlock lock;
+
+  // rr and mlfq: FIFO queues, linked through p->rqnext.
+  struct proc *head[NMLFQ];
+  struct proc *tail[NMLFQ];
+  uint boostgen;        // number of priority boosts so far
+
+  int n;                // number of queued processes
+
+  // fair: a binary min-heap ordered by p->vruntime.
+  struct proc *heap[NPROC];
+  int nheap;
+  uint64 minvruntime;   // vruntime of the last process picked
+} runq;
+
+// A scheduling class. runq.lock is held when these are called,
+// on the hart that is choosing what to run.
+struct sclass {
+  // queue RUNNABLE p; wakeup is set if p has been
+  // sleeping or is new, rather than preempted.
+  void (*enqueue)(struct proc *p, int wakeup);
+  // the queued process this hart should run next, or 0.
+  struct proc *(*peek)(void);
+  // take queued p off the run queue, to run it.
+  void (*remove)(struct proc *p);
+  // p ran for delta cycles of the time CSR.
+  void (*charge)(struct proc *p, uint64 delta);
+  // a timer tick hit running p; return 1 to preempt it.
+  int (*tick)(struct proc *p);
+  // should a queued process run before RUNNABLE p?
+  int (*ahead)(struct proc *p);
+  // ticks left in running p's slice, at least 1.
+  int (*left)(struct proc *p);
+};
+
+// may p run on this hart?
+static int
+here(struct proc *p)
+{
+  return (p->affinity >> cpuid()) & 1;
+}
+
+// FIFO queue helpers, used by rr and mlfq.
+
+static void
+fifoput(struct proc *p, int l)
+{
+  p->rqnext = 0;
+  if(runq.tail[l])
+    runq.tail[l]->rqnext = p;
+  else
+    runq.head[l] = p;
+  runq.tail[l] = p;
+}
+
+// the first process on queue l that may run here.
+static struct proc*
+fifofirst(int l)
+{
+  struct proc *p;
+
+  for(p = runq.head[l]; p; p = p->rqnext)
+    if(here(p))
+      return p;
+  return 0;
+}
+
+static void
+fiforemove(struct proc *p, int l)
+{
+  struct proc **pp, *prev = 0;
+
+  for(pp = &runq.head[l]; *pp; prev = *pp, pp = &(*pp)->rqnext){
+    if(*pp == p){
+      *pp = p->rqnext;
+      if(runq.tail[l] == p)
+        runq.tail[l] = prev;
+      p->rqnext = 0;
+      return;
+    }
+  }
+  panic("fiforemove");
+}
+
+static void
+nocharge(struct proc *p, uint64 delta)
+{
+}
+
+static int
+oneleft(struct proc *p)
+{
+  return 1;
+}
+
+// rr
+
+static void
+rrenqueue(struct proc *p, int wakeup)
+{
+  fifoput(p, 0);
+}
+
+static struct proc*
+rrpeek(void)
+{
+  return fifofirst(0);
+}
+
+static void
+rrremove(struct proc *p)
+{
+  fiforemove(p, 0);
+}
+
+static int
+rrtick(struct proc *p)
+{
+  return 1;
+}
+
+static int
+rrahead(struct proc *p)
+{
+  return rrpeek() != 0;
+}
+
+struct sclass rrclass = {
+  rrenqueue, rrpeek, rrremove, nocharge, rrtick, rrahead, oneleft,
+};
+
+// mlfq
+
+// the highest level p's nice value lets it reach.
+static int
+toplevel(struct proc *p)
+{
+  if(p->nice <= 0)
+    return 0;
+  return p->nice * NMLFQ / (NICE_MAX + 1);
+}
+
+static int
+slice(struct proc *p)
+{
+  return p->nice < 0 ? 2*mlfqslice[p->level] : mlfqslice[p->level];
+}
+
+// bring p's level up to date with boosts and nice
+// changes that happened while it wasn't queued.
+static void
+fixlevel(struct proc *p)
+{
+  if(p->boostgen != runq.boostgen){
+    p->boostgen = runq.boostgen;
+    p->level = toplevel(p);
+    p->slice = 0;
+  } else if(p->level < toplevel(p)){
+    p->level = toplevel(p);
+    p->slice = 0;
+  }
+}
+
+static void
+mlfqenqueue(struct proc *p, int wakeup)
+{
+  fixlevel(p);
+  fifoput(p, p->level);
+}
+
+static struct proc*
+mlfqpeek(void)
+{
+  struct proc *p;
+
+  for(int l = 0; l < NMLFQ; l++)
+    if((p = fifofirst(l)) != 0)
+      return p;
+  return 0;
+}
+
+static void
+mlfqremove(struct proc *p)
+{
+  // p->level is the queue mlfqenqueue() put it on.
+  fiforemove(p, p->level);
+}
+
+static int
+mlfqtick(struct proc *p)
+{
+  struct proc *q;
+  int preempt = 0;
+
+  fixlevel(p);
+  if(++p->slice >= slice(p)){
+    if(p->level < NMLFQ-1)
+      p->level++;
+    p->slice = 0;
+    preempt = 1;
+  }
+  if((q = mlfqpeek()) != 0 && q->level < p->level)
+    preempt = 1;
+  return preempt;
+}
+
+static int
+mlfqahead(struct proc *p)
+{
+  struct proc *q;
+
+  fixlevel(p);
+  return (q = mlfqpeek()) != 0 && q->level <= p->level;
+}
+
+static int
+mlfqleft(struct proc *p)
+{
+  fixlevel(p);
+  return slice(p) - p->slice;
+}
+
+struct sclass mlfqclass = {
+  mlfqenqueue, mlfqpeek, mlfqremove, nocharge, mlfqtick, mlfqahead,
+  mlfqleft,
+};
+
+// fair
+
+static void
+heapswap(int i, int j)
+{
+  struct proc *p = runq.heap[i];
+
+  runq.heap[i] = runq.heap[j];
+  runq.heap[j] = p;
+  runq.heap[i]->rqidx = i;
+  runq.heap[j]->rqidx = j;
+}
+
+static void
+siftup(int i)
+{
+  while(i > 0 && runq.heap[i]->vruntime < runq.heap[(i-1)/2]->vruntime){
+    heapswap(i, (i-1)/2);
+    i = (i-1)/2;
+  }
+}
+
+static void
+siftdown(int i)
+{
+  int l, min;
+
+  for(;;){
+    min = i;
+    l = 2*i + 1;
+    if(l < runq.nheap && runq.heap[l]->vruntime < runq.heap[min]->vruntime)
+      min = l;
+    if(l+1 < runq.nheap && runq.heap[l+1]->vruntime < runq.heap[min]->vruntime)
+      min = l+1;
+    if(min == i)
+      break;
+    heapswap(i, min);
+    i = min;
+  }
+}
+
+static void
+fairenqueue(struct proc *p, int wakeup)
+{
+  // a process that slept doesn't get to bank the time
+  // it wasn't runnable; it rejoins just ahead of the pack.
+  if(wakeup && p->vruntime + FAIRGRAN < runq.minvruntime)
+    p->vruntime = runq.minvruntime - FAIRGRAN;
+
+  if(runq.nheap >= NPROC)
+    panic("fairenqueue");
+  p->rqidx = runq.nheap++;
+  runq.heap[p->rqidx] = p;
+  siftup(p->rqidx);
+}
+
+// the heap's minimum, unless affinity keeps it off this
+// hart; then the least vruntime of those that may run here.
+static struct proc*
+fairpeek(void)
+{
+  struct proc *p, *min = 0;
+
+  if(runq.nheap > 0 && here(runq.heap[0]))
+    return runq.heap[0];
+  for(int i = 1; i < runq.nheap; i++){
+    p = runq.heap[i];
+    if(here(p) && (min == 0 || p->vruntime < min->vruntime))
+      min = p;
+  }
+  return min;
+}
+
+static void
+fairremove(struct proc *p)
+{
+  int i = p->rqidx;
+
+  runq.nheap--;
+  if(i < runq.nheap){
+    heapswap(i, runq.nheap);
+    siftup(i);
+    siftdown(i);
+  }
+  if(p->vruntime > runq.minvruntime)
+    runq.minvruntime = p->vruntime;
+}
+
+static void
+faircharge(struct proc *p, uint64 delta)
+{
+  p->vruntime += delta * NICE0WEIGHT / niceweight[p->nice - NICE_MIN];
+}
+
+static int
+fairtick(struct proc *p)
+{
+  struct proc *q;
+
+  return (q = fairpeek()) != 0 && p->vruntime > q->vruntime + FAIRGRAN;
+}
+
+static int
+fairahead(struct proc *p)
+{
+  struct proc *q;
+
+  return (q = fairpeek()) != 0 && q->vruntime <= p->vruntime;
+}
+
+struct sclass fairclass = {
+  fairenqueue, fairpeek, fairremove, faircharge, fairtick, fairahead,
+  oneleft,
+};
+
+static struct sclass *sclass = &SCHEDCLASS;
+
+// harts waiting in idle() for work, one bit per hart.
+static uint64 idlemask;
+
+// harts running a process with nothing else queued for
+// them, and so with their ticks stopped.
+static uint64 ticklessmask;
+
+// hand the CPU to a just-woken process? see sethandoff().
+static int handoff = 1;
+
+void
+runqinit(void)
+{
+  initlock(&runq.lock, "runq");
+}
+
+// charge p for the time since it last started running
+// or was last charged. runq.lock must be held.
+static void
+charge(struct proc *p)
+{
+  uint64 now = r_time();
+
+  sclass->charge(p, now - p->runstart);
+  p->runstart = now;
+}
+
+// queue RUNNABLE p. runq.lock must be held.
+static void
+rqadd(struct proc *p, int wakeup)
+{
+  sclass->enqueue(p, wakeup);
+  p->onrq = 1;
+  p->queuedat = r_time();
+  runq.n++;
+}
+
+// take p, or if p is 0 the next process to run, off the
+// run queue and start its clock. runq.lock must be held.
+static struct proc*
+rqtake(struct proc *p)
+{
+  if(p == 0 && (p = sclass->peek()) == 0)
+    return 0;
+  sclass->remove(p);
+  if(ticklessmask & (1L << cpuid())){
+    // p is not the process the ticks were stopped for.
+    __sync_fetch_and_and(&ticklessmask, ~(1L << cpuid()));
+    tickstart();
+  }
+  p->onrq = 0;
+  p->donated = 0;
+  p->runstart = p->cpustamp = r_time();
+  p->waittime += p->runstart - p->queuedat;
+  p->hart = cpuid();
+  runq.n--;
+  return p;
+}
+
+// Wake one hart in mask that is waiting in idle(),
+// if there is one, to run a newly queued process.
+// Returns 1 if it woke one.
+static int
+kickidle(uint64 mask)
+{
+  uint64 bit;
+
+  for(int i = 0; i < NCPU; i++){
+    bit = 1L << i;
+    if((mask & idlemask & bit) && (__sync_fetch_and_and(&idlemask, ~bit) & bit)){
+      ipi(i);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Restart the ticks of one hart in mask that stopped them
+// to run a single process, so that it will share itself
+// with a newly queued one. Called with interrupts off.
+static void
+kicktickless(uint64 mask)
+{
+  uint64 bit;
+
+  for(int i = 0; i < NCPU; i++){
+    bit = 1L << i;
+    if((mask & ticklessmask & bit) && (__sync_fetch_and_and(&ticklessmask, ~bit) & bit)){
+      if(i == cpuid())
+        tickstart();
+      else
+        ipi(i);
+      return;
+    }
+  }
+}
+
+// Make p, RUNNING on its hart, trap into the kernel soon:
+// restart that hart's ticks if they are stopped, since
+// a process alone on a hart may never trap otherwise.
+// For kill(), setaffinity() and sampleattach().
+// Caller must hold p->lock.
+void
+schedkick(struct proc *p)
+{
+  uint64 bit = 1L << p->hart;
+
+  // schedtick() stops the ticks under runq.lock, after
+  // looking at p->killed, p->affinity and p->sampler.
+  acquire(&runq.lock);
+  if(__sync_fetch_and_and(&ticklessmask, ~bit) & bit){
+    if(p->hart == cpuid())
+      tickstart();
+    else
+      ipi(p->hart);
+  }
+  release(&runq.lock);
+}
+
+// Called by scheduler() when runqget() found nothing.
+// Rather than spin on the run queue, wait in wfi for an
+// interrupt: a device, the timer, or an IPI from kickidle()
+// when a process is queued.
+void
+idle(void)
+{
+  struct cpu *c = mycpu();
+  uint64 bit = 1L << cpuid();
+  uint64 t0;
+  int empty;
+
+  // with interrupts off, an IPI sent after the run queue
+  // check stays pending and makes wfi return at once.
+  // the ticks stop while idle; only timers that are due,
+  // devices and IPIs wake the hart.
+  intr_off();
+  __sync_fetch_and_and(&ticklessmask, ~bit);
+  __sync_fetch_and_or(&idlemask, bit);
+  acquire(&runq.lock);
+  empty = (sclass->peek() == 0);
+  release(&runq.lock);
+  if(empty){
+    tickstop();
+    t0 = r_time();
+    wfi();
+    c->idletime += r_time() - t0;
+    tickstart();
+  }
+  __sync_fetch_and_and(&idlemask, ~bit);
+  intr_on();
+}
+
+// Queue a process that has just become RUNNABLE
+// after sleeping or being created.
+// Caller must hold p->lock.
+void
+runqput(struct proc *p)
+{
+  uint64 mask;
+
+  if(!holding(&p->lock) || p->state != RUNNABLE)
+    panic("runqput");
+
+  acquire(&runq.lock);
+  rqadd(p, 1);
+  mask = p->affinity;
+  release(&runq.lock);
+
+  if(!kickidle(mask))
+    kicktickless(mask);
+}
+
+// Remove and return the next process to run,
+// or 0 if nothing is RUNNABLE.
+// The caller must acquire p->lock before running it.
+struct proc*
+runqget(void)
+{
+  struct proc *p;
+
+  acquire(&runq.lock);
+  p = rqtake(0);
+  release(&runq.lock);
+  return p;
+}
+
+// p, running on this CPU, is giving up the CPU and has
+// already changed p->state. Charge it for the CPU it used
+// and choose what runs next:
+//  - p itself, if it is still RUNNABLE (it yielded), may
+//    run on this hart, and nothing queued should run ahead
+//    of it;
+//  - the process p woke last, if p is blocking and that
+//    process is still queued, with the rest of p's slice;
+//  - otherwise a process taken off the run queue, with p
+//    queued again if it is RUNNABLE;
+//  - or 0 if nothing is runnable at all.
+// The next process is taken off the queue before p goes
+// back on, so two CPUs can never pick each other's outgoing
+// process and deadlock on their p->locks in sched().
+// Caller must hold p->lock.
+struct proc*
+schedswitch(struct proc *p)
+{
+  struct proc *np, *wakee;
+  int left, away;
+
+  wakee = p->wakee;
+  p->wakee = 0;
+
+  acquire(&runq.lock);
+  charge(p);
+  if(p->state == RUNNABLE && here(p) && !sclass->ahead(p)){
+    release(&runq.lock);
+    return p;
+  }
+  if(handoff && p->state == SLEEPING && wakee && wakee->onrq && here(wakee)){
+    // a queued process can't be freed, so wakee is still
+    // the process p woke, or at worst a RUNNABLE one that
+    // was recycled from it in the meantime.
+    left = p->donated ? p->donated : sclass->left(p);
+    np = rqtake(wakee);
+    np->donated = left;
+  } else {
+    np = rqtake(0);
+  }
+  p->donated = 0;
+  away = 0;
+  if(p->state == RUNNABLE){
+    rqadd(p, 0);
+    p->nivcsw++;
+    away = !here(p);
+  } else if(p->state == SLEEPING){
+    p->nvcsw++;
+  }
+  p->stime += r_time() - p->cpustamp;
+  release(&runq.lock);
+  // p left because its affinity moved it off this hart;
+  // as in runqput(), wake a hart that can run it.
+  if(away && !kickidle(p->affinity))
+    kicktickless(p->affinity);
+  return np;
+}
+
+// Charge a timer tick to p, which is running on this CPU.
+// Returns 1 if p should yield to another process.
+// If nothing else is queued that could run here, the ticks
+// stop until runqput() queues something that could.
+// Called with interrupts off.
+int
+schedtick(struct proc *p)
+{
+  int preempt, stop;
+
+  acquire(&runq.lock);
+  charge(p);
+  if(!here(p)){
+    // its affinity changed while it was running.
+    preempt = 1;
+  } else if(p->donated > 0){
+    // running on a slice handed over by the process that
+    // woke p; when it runs out, let anything queued go first.
+    preempt = --p->donated == 0 && sclass->peek() != 0;
+  } else {
+    preempt = sclass->tick(p);
+  }
+  // runqput() queues under runq.lock before it looks at
+  // ticklessmask, so can't miss this hart.
+  // a process being sampled, or the kernel profiler,
+  // needs the ticks.
+  stop = !preempt && sclass->peek() == 0 && p->sampler == 0 && !kprofon && !p->killed;
+  if(stop)
+    __sync_fetch_and_or(&ticklessmask, 1L << cpuid());
+  release(&runq.lock);
+  // an IPI from kicktickless() in the meantime is pending
+  // until interrupts are back on, and so restarts the
+  // ticks after this.
+  if(stop)
+    tickstop();
+  return preempt;
+}
+
+// Turn the wakeup handoff on or off.
+// Returns the previous setting.
+int
+sethandoff(int on)
+{
+  int old;
+
+  acquire(&runq.lock);
+  old = handoff;
+  handoff = on != 0;
+  release(&runq.lock);
+  return old;
+}
+
+// Move every mlfq process back to its top level.
+// Called periodically from clockintr().
+void
+runqboost(void)
+{
+  struct proc *p, *next;
+  int l;
+
+  if(sclass != &mlfqclass)
+    return;
+
+  acquire(&runq.lock);
+  runq.boostgen++;
+  for(l = 1; l < NMLFQ; l++){
+    p = runq.head[l];
+    runq.head[l] = runq.tail[l] = 0;
+    for(; p; p = next){
+      next = p->rqnext;
+      mlfqenqueue(p, 0);
+    }
+  }
+  release(&runq.lock);
+}
+
+// Set up the scheduling state of a new process np,
+// created by fork() from p. The nice value and affinity
+// are inherited.
+void
+schedfork(struct proc *np, struct proc *p)
+{
+  acquire(&runq.lock);
+  np->nice = p ? p->nice : 0;
+  np->affinity = p ? p->affinity : ALLHARTS;
+  np->boostgen = runq.boostgen;
+  np->level = toplevel(np);
+  np->slice = 0;
+  np->vruntime = runq.minvruntime;
+  release(&runq.lock);
+}
+
+// Set the nice value of process pid (0 means the caller).
+// Takes effect the next time the process is queued or ticks.
+int
+setpriority(int pid, int nice)
+{
+  struct proc *p;
+
+  if(nice < NICE_MIN || nice > NICE_MAX)
+    return -1;
+  if((p = findproc(pid)) == 0)
+    return -1;
+  acquire(&runq.lock);
+  p->nice = nice;
+  release(&runq.lock);
+  release(&p->lock);
+  return 0;
+}
+
+// Return the nice value of process pid (0 means the caller),
+// or a value below NICE_MIN if there is no such process.
+int
+getpriority(int pid)
+{
+  struct proc *p;
+  int nice;
+
+  if((p = findproc(pid)) == 0)
+    return NICE_MIN - 1;
+  nice = p->nice;
+  release(&p->lock);
+  return nice;
+}
+
+// Let process pid (0 means the caller) run only on the
+// harts in mask, one bit per hart. The mask must include
+// a hart that is running. A running process moves off a
+// hart no longer in its mask at the next timer tick, which
+// schedkick() makes sure comes, or at once if it is the
+// caller.
+int
+setaffinity(int pid, uint64 mask)
+{
+  struct proc *p;
+  uint64 online = 0;
+  int move, queued;
+
+  for(int i = 0; i < NCPU; i++)
+    if(cpus[i].online)
+      online |= 1L << i;
+  if((mask & online) == 0)
+    return -1;
+  if((p = findproc(pid)) == 0)
+    return -1;
+  acquire(&runq.lock);
+  p->affinity = mask & ALLHARTS;
+  move = (p == myproc() && !here(p));
+  queued = p->onrq;
+  release(&runq.lock);
+  // a queued process may now only be able to run on harts
+  // that are idle or tickless, which nothing would tell.
+  if(queued && !kickidle(p->affinity))
+    kicktickless(p->affinity);
+  if(p->state == RUNNING && p != myproc() && !(p->affinity & (1L << p->hart)))
+    schedkick(p);
+  release(&p->lock);
+  if(move)
+    yield();
+  return 0;
+}
+
+// Return the affinity mask of process pid (0 means the
+// caller), or -1 if there is no such process.
+int
+getaffinity(int pid)
+{
+  struct proc *p;
+  int mask;
+
+  if((p = findproc(pid)) == 0)
+    return -1;
+  mask = p->affinity;
+  release(&p->lock);
+  return mask;
+}
@@ -0,0 +1,13 @@
+// Per-system-call counts and latencies, summed over the
+// harts by the scstat() system call. Times are in time CSR
+// cycles; hist[i] counts calls that took less than 2^i
+// cycles and at least 2^(i-1), the last bucket everything
+// longer.
+#define NSCHIST 24
+
+struct scstat {
+  uint64 count;
+  uint64 time;             // total
+  uint64 max;
+  uint64 hist[NSCHIST];
+};
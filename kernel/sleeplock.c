@@ -1,4 +1,11 @@
 // Sleeping locks
+//
+// Adaptive: a process that finds the lock held by a process
+// running on another hart spins for a while before
+// sleeping, since the holder may well be about to let go,
+// and sleeping costs two context switches. It sleeps at
+// once if the holder is not running, and after SPINTIME
+// in any case.
 
 #include "types.h"
 #include "riscv.h"
@@ -9,6 +16,10 @@
 #include "proc.h"
 #include "sleeplock.h"
 
+#define SPINTIME (TIMEBASE / 20000)   // 50us of the time CSR
+
+int sleepspin = 1;
+
 void
 initsleeplock(struct sleeplock *lk, char *name)
 {
@@ -16,17 +27,45 @@ initsleeplock(struct sleeplock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->pid = 0;
+  lk->owner = 0;
+}
+
+// Spin, with no locks held, while lk is held by a process
+// running on another hart, until deadline.
+// Returns 0 if it is time to sleep instead.
+static int
+spinwait(struct sleeplock *lk, uint64 deadline)
+{
+  struct proc *o;
+
+  // procs are never freed, so o stays valid; its fields
+  // are read without its lock, only as a hint.
+  while((o = __atomic_load_n(&lk->owner, __ATOMIC_RELAXED)) != 0){
+    if(__atomic_load_n(&o->state, __ATOMIC_RELAXED) != RUNNING || r_time() >= deadline)
+      return 0;
+  }
+  return 1;
 }
 
 void
 acquiresleep(struct sleeplock *lk)
 {
+  uint64 deadline = r_time() + SPINTIME;
+  int spin = sleepspin;
+
   acquire(&lk->lk);
   while (lk->locked) {
+    if(spin && lk->owner){
+      release(&lk->lk);
+      spin = spinwait(lk, deadline);
+      acquire(&lk->lk);
+      continue;
+    }
     sleep(lk, &lk->lk);
   }
   lk->locked = 1;
   lk->pid = myproc()->pid;
+  lk->owner = myproc();
   release(&lk->lk);
 }
 
@@ -36,6 +75,7 @@ releasesleep(struct sleeplock *lk)
   acquire(&lk->lk);
   lk->locked = 0;
   lk->pid = 0;
+  lk->owner = 0;
   wakeup(lk);
   release(&lk->lk);
 }
@@ -51,5 +91,13 @@ holdingsleep(struct sleeplock *lk)
   return r;
 }
 
+// Turn spinning in acquiresleep() on or off.
+// Returns the previous setting.
+int
+setsleepspin(int on)
+{
+  int old = sleepspin;
 
-
+  sleepspin = on != 0;
+  return old;
+}
@@ -6,5 +6,7 @@ struct sleeplock {
   // For debugging:
   char *name;        // Name of lock.
   int pid;           // Process holding lock
+
+  struct proc *owner; // Process holding lock, for acquiresleep() to watch
 };
 
@@ -6,14 +6,107 @@
 #include "spinlock.h"
 #include "riscv.h"
 #include "proc.h"
+#include "lockstat.h"
 #include "defs.h"
 
+#define NLOCKCLASS 48
+
+// Statistics are kept for each lock name, a lock class,
+// rather than each lock, since pipes, thread groups and
+// pollers come and go, and the proc locks are of a kind.
+// Each hart counts in its own entries, with interrupts
+// off, so acquire() adds no shared writes.
+struct lockclass {
+  char *name;
+  int nlocks;
+  struct {
+    uint64 nacquire;
+    uint64 ncontend;
+    uint64 spins;
+    uint64 maxhold;
+  } cpu[NCPU];
+};
+
+struct lockclass lockclass[NLOCKCLASS];
+int nlockclass;
+// protects adding to lockclass[]; not itself counted.
+struct spinlock classlock = { .name = "lockclass" };
+
+// Find or make the class for locks named name,
+// or return 0 if lockclass[] is full.
+static struct lockclass*
+findclass(char *name)
+{
+  struct lockclass *c;
+  int i;
+
+  acquire(&classlock);
+  for(i = 0; i < nlockclass; i++)
+    if(strncmp(lockclass[i].name, name, LOCKNAME) == 0)
+      break;
+  if(i == nlockclass && nlockclass < NLOCKCLASS){
+    lockclass[i].name = name;
+    // lockstat() reads lockclass[] without the lock.
+    __sync_synchronize();
+    nlockclass++;
+  }
+  c = i < nlockclass ? &lockclass[i] : 0;
+  release(&classlock);
+  return c;
+}
+
 void
 initlock(struct spinlock *lk, char *name)
+{
+  initlocknostat(lk, name);
+  lk->cls = findclass(name);
+  if(lk->cls)
+    __sync_fetch_and_add(&lk->cls->nlocks, 1);
+}
+
+// Like initlock(), for locks made over and over as the
+// kernel runs, such as pipes' and thread groups': the
+// caller keeps *cls, 0 at first, and only the first call
+// looks the class up, so later ones skip classlock.
+void
+initlockclass(struct spinlock *lk, char *name, struct lockclass **cls)
+{
+  struct lockclass *c;
+
+  initlocknostat(lk, name);
+  if((c = __atomic_load_n(cls, __ATOMIC_ACQUIRE)) == 0){
+    c = findclass(name);
+    __atomic_store_n(cls, c, __ATOMIC_RELEASE);
+  }
+  lk->cls = c;
+  if(c)
+    __sync_fetch_and_add(&c->nlocks, 1);
+}
+
+// A lock that lockstat doesn't count, for short-lived
+// locks such as those on the stack.
+void
+initlocknostat(struct spinlock *lk, char *name)
 {
   lk->name = name;
   lk->locked = 0;
   lk->cpu = 0;
+  lk->cls = 0;
+}
+
+// Make a fair lock: where an ordinary spin lock goes to
+// whichever cpu's atomic swap happens to land first, so a
+// cpu can lose again and again under contention, a ticket
+// lock goes to the cpus in the order they asked for it.
+// It costs a second atomic in release(), so it suits the
+// locks that are actually contended.
+void
+initticketlock(struct spinlock *lk, char *name)
+{
+  initlock(lk, name);
+  lk->ticket = 1;
+  lk->next = 0;
+  lk->owner = 0;
 }
 
 // Acquire the lock.
@@ -29,8 +122,17 @@ acquire(struct spinlock *lk)
   //   a5 = 1
   //   s1 = &lk->locked
   //   amoswap.w.aq a5, a5, (s1)
-  while(__sync_lock_test_and_set(&lk->locked, 1) != 0)
-    ;
+  uint64 spins = 0;
+  if(lk->ticket){
+    // take a ticket and wait for it to come up.
+    uint t = __sync_fetch_and_add(&lk->next, 1);
+    while(__atomic_load_n(&lk->owner, __ATOMIC_ACQUIRE) != t)
+      spins++;
+    lk->locked = 1;
+  } else {
+    while(__sync_lock_test_and_set(&lk->locked, 1) != 0)
+      spins++;
+  }
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that the critical section's memory
@@ -40,6 +142,16 @@ acquire(struct spinlock *lk)
 
   // Record info about lock acquisition for holding() and debugging.
   lk->cpu = mycpu();
+
+  if(lk->cls){
+    int id = cpuid();
+    lk->cls->cpu[id].nacquire++;
+    if(spins){
+      lk->cls->cpu[id].ncontend++;
+      lk->cls->cpu[id].spins += spins;
+    }
+    lk->since = r_time();
+  }
 }
 
 // Release the lock.
@@ -49,6 +161,13 @@ release(struct spinlock *lk)
   if(!holding(lk))
     panic("release");
 
+  if(lk->cls){
+    uint64 held = r_time() - lk->since;
+    int id = cpuid();
+    if(held > lk->cls->cpu[id].maxhold)
+      lk->cls->cpu[id].maxhold = held;
+  }
+
   lk->cpu = 0;
 
   // Tell the C compiler and the CPU to not move loads or stores
@@ -66,7 +185,13 @@ release(struct spinlock *lk)
   // On RISC-V, sync_lock_release turns into an atomic swap:
   //   s1 = &lk->locked
   //   amoswap.w zero, zero, (s1)
-  __sync_lock_release(&lk->locked);
+  // A ticket lock is released by serving the next ticket.
+  if(lk->ticket){
+    lk->locked = 0;
+    __atomic_store_n(&lk->owner, lk->owner + 1, __ATOMIC_RELEASE);
+  } else {
+    __sync_lock_release(&lk->locked);
+  }
 
   pop_off();
 }
@@ -108,3 +233,73 @@ pop_off(void)
   if(c->noff == 0 && c->intena)
     intr_on();
 }
+
+// Copy the statistics of up to n lock classes, summed over
+// the harts, to the struct lockstat array at user address
+// addr, then clear them if reset is set. Counts from
+// acquisitions meanwhile may be missed.
+// Returns the number of lock classes, or -1.
+int
+lockstat(uint64 addr, int n, int reset)
+{
+  struct lockclass *c;
+  struct lockstat ls;
+  int i, k, nc;
+
+  nc = nlockclass;
+  __sync_synchronize();
+  for(i = 0; i < n && i < nc; i++){
+    c = &lockclass[i];
+    memset(&ls, 0, sizeof(ls));
+    safestrcpy(ls.name, c->name, sizeof(ls.name));
+    ls.nlocks = c->nlocks;
+    for(k = 0; k < NCPU; k++){
+      ls.nacquire += c->cpu[k].nacquire;
+      ls.ncontend += c->cpu[k].ncontend;
+      ls.spins += c->cpu[k].spins;
+      if(c->cpu[k].maxhold > ls.maxhold)
+        ls.maxhold = c->cpu[k].maxhold;
+    }
+    if(copyout(myproc()->pagetable, addr + i * sizeof(ls), (char*)&ls, sizeof(ls)) < 0)
+      return -1;
+  }
+  if(reset)
+    for(i = 0; i < nc; i++)
+      memset(lockclass[i].cpu, 0, sizeof(lockclass[i].cpu));
+  return nc;
+}
+
+// For user/lockbench: a lock of each kind, and counters
+// they protect. Not in lockstat, being set up statically.
+static struct spinlock benchlock[2] = {
+  { .name = "bench" },
+  { .name = "benchticket", .ticket = 1 },
+};
+static uint64 benchcount[2];
+
+// Take and release the benchmark's ticket lock, if ticket
+// is set, or its ordinary spin lock, for ms milliseconds,
+// bumping a shared counter each time. Stops early if the
+// caller is killed.
+// Returns the number of times, or -1 if ms is out of range.
+int
+lockbench(int ticket, int ms)
+{
+  struct spinlock *lk = &benchlock[ticket != 0];
+  uint64 end;
+  int n = 0;
+
+  if(ms <= 0 || ms > LOCKBENCHMS)
+    return -1;
+  end = r_time() + (uint64)ms * (TIMEBASE / 1000);
+  while(r_time() < end){
+    acquire(lk);
+    benchcount[ticket != 0]++;
+    release(lk);
+    // killed() takes p->lock; don't let it crowd the
+    // lock being measured.
+    if(++n % 1024 == 0 && killed(myproc()))
+      break;
+  }
+  return n;
+}
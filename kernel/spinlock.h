@@ -2,8 +2,18 @@
 struct spinlock {
   uint locked;       // Is the lock held?
 
+  // A ticket lock, from initticketlock(), hands itself to
+  // the spinning cpus in the order they came:
+  int ticket;        // Is this a ticket lock?
+  uint next;         // Next ticket to hand out
+  uint owner;        // Ticket now being served
+
   // For debugging:
   char *name;        // Name of lock.
   struct cpu *cpu;   // The cpu holding the lock.
+
+  // For lockstat, see spinlock.c:
+  struct lockclass *cls;  // Statistics for locks of this name, or 0
+  uint64 since;      // time CSR when acquired
 };
 
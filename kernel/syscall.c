@@ -5,6 +5,8 @@
 #include "spinlock.h"
 #include "proc.h"
 #include "syscall.h"
+#include "trace.h"
+#include "scstat.h"
 #include "defs.h"
 
 // Fetch the uint64 at addr from the current process.
@@ -12,7 +14,7 @@ int
 fetchaddr(uint64 addr, uint64 *ip)
 {
   struct proc *p = myproc();
-  if(addr >= p->sz || addr+sizeof(uint64) > p->sz) // both tests needed, in case of overflow
+  if(addr >= p->tg->sz || addr+sizeof(uint64) > p->tg->sz) // both tests needed, in case of overflow
     return -1;
   if(copyin(p->pagetable, (char *)ip, addr, sizeof(*ip)) != 0)
     return -1;
@@ -103,6 +105,32 @@ extern uint64 sys_mkdir(void);
 extern uint64 sys_close(void);
 extern uint64 sys_dump(void);
 extern uint64 sys_dump2(void);
+extern uint64 sys_setpriority(void);
+extern uint64 sys_getpriority(void);
+extern uint64 sys_cpustat(void);
+extern uint64 sys_sethandoff(void);
+extern uint64 sys_clone(void);
+extern uint64 sys_join(void);
+extern uint64 sys_sbrkshared(void);
+extern uint64 sys_futex_wait(void);
+extern uint64 sys_futex_wake(void);
+extern uint64 sys_sched_setaffinity(void);
+extern uint64 sys_sched_getaffinity(void);
+extern uint64 sys_procstat(void);
+extern uint64 sys_nanosleep(void);
+extern uint64 sys_clock_gettime(void);
+extern uint64 sys_ringsetup(void);
+extern uint64 sys_ringenter(void);
+extern uint64 sys_poll(void);
+extern uint64 sys_regsnap(void);
+extern uint64 sys_sampleattach(void);
+extern uint64 sys_sampledetach(void);
+extern uint64 sys_kprof(void);
+extern uint64 sys_scstat(void);
+extern uint64 sys_trace(void);
+extern uint64 sys_lockstat(void);
+extern uint64 sys_lockbench(void);
+extern uint64 sys_setsleepspin(void);
 
 // An array mapping syscall numbers from syscall.h
 // to the function that handles the system call.
@@ -130,8 +158,89 @@ static uint64 (*syscalls[])(void) = {
 [SYS_close]   sys_close,
 [SYS_dump]    sys_dump,
 [SYS_dump2]   sys_dump2,
+[SYS_setpriority] sys_setpriority,
+[SYS_getpriority] sys_getpriority,
+[SYS_cpustat] sys_cpustat,
+[SYS_sethandoff] sys_sethandoff,
+[SYS_clone]   sys_clone,
+[SYS_join]    sys_join,
+[SYS_sbrkshared] sys_sbrkshared,
+[SYS_futex_wait] sys_futex_wait,
+[SYS_futex_wake] sys_futex_wake,
+[SYS_sched_setaffinity] sys_sched_setaffinity,
+[SYS_sched_getaffinity] sys_sched_getaffinity,
+[SYS_procstat] sys_procstat,
+[SYS_nanosleep] sys_nanosleep,
+[SYS_clock_gettime] sys_clock_gettime,
+[SYS_ringsetup] sys_ringsetup,
+[SYS_ringenter] sys_ringenter,
+[SYS_poll]    sys_poll,
+[SYS_regsnap] sys_regsnap,
+[SYS_sampleattach] sys_sampleattach,
+[SYS_sampledetach] sys_sampledetach,
+[SYS_kprof]   sys_kprof,
+[SYS_scstat]  sys_scstat,
+[SYS_trace]   sys_trace,
+[SYS_lockstat] sys_lockstat,
+[SYS_lockbench] sys_lockbench,
+[SYS_setsleepspin] sys_setsleepspin,
 };
 
+// each hart's counts, updated with interrupts off and no
+// lock, for the calls that finish on it.
+static struct scstat scstats[NCPU][NELEM(syscalls)];
+
+// Charge a call to system call num that took t cycles.
+static void
+sccharge(int num, uint64 t)
+{
+  struct scstat *s;
+  int i;
+
+  push_off();
+  s = &scstats[cpuid()][num];
+  s->count++;
+  s->time += t;
+  if(t > s->max)
+    s->max = t;
+  for(i = 0; i < NSCHIST - 1 && t >= (1L << i); i++)
+    ;
+  s->hist[i]++;
+  pop_off();
+}
+
+// Copy the statistics of system calls 0 to n-1, summed over
+// the harts, to the struct scstat array at user address
+// addr, then clear them if reset is set. A call finishing
+// meanwhile may be missed or half counted.
+// Returns the number of system calls there are, or -1.
+int
+scstat(uint64 addr, int n, int reset)
+{
+  struct scstat s;
+  int num, i, k;
+
+  if(n > NELEM(syscalls))
+    n = NELEM(syscalls);
+  for(num = 0; num < n; num++){
+    memset(&s, 0, sizeof(s));
+    for(i = 0; i < NCPU; i++){
+      s.count += scstats[i][num].count;
+      s.time += scstats[i][num].time;
+      if(scstats[i][num].max > s.max)
+        s.max = scstats[i][num].max;
+      for(k = 0; k < NSCHIST; k++)
+        s.hist[k] += scstats[i][num].hist[k];
+    }
+    if(copyout(myproc()->pagetable, addr + num * sizeof(s), (char*)&s, sizeof(s)) < 0)
+      return -1;
+  }
+  if(reset)
+    for(i = 0; i < NCPU; i++)
+      memset(scstats[i], 0, sizeof(scstats[i]));
+  return NELEM(syscalls);
+}
+
 void
 syscall(void)
 {
@@ -142,7 +251,16 @@ syscall(void)
   if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
     // Use num to lookup the system call function for num, call it,
     // and store its return value in p->trapframe->a0
+    // a process being straced logs its calls even when
+    // no one is tracing system calls in general.
+    uint64 t0 = r_time();
+    int traced = ((p->sctrace >> num) & 1) ? TR_STRACED : 0;
+    if(traced || (tracemask & (1 << TR_SYSCALL)))
+      trace(TR_SYSCALL | traced, num, p->trapframe->a0, p->trapframe->a1, p->trapframe->a2);
     p->trapframe->a0 = syscalls[num]();
+    if(traced || (tracemask & (1 << TR_SYSRET)))
+      trace(TR_SYSRET | traced, num, p->trapframe->a0, 0, 0);
+    sccharge(num, r_time() - t0);
   } else {
     printf("%d %s: unknown sys call %d\n",
             p->pid, p->name, num);
@@ -22,3 +22,29 @@
 #define SYS_close  21
 #define SYS_dump   22
 #define SYS_dump2  23
+#define SYS_setpriority 24
+#define SYS_getpriority 25
+#define SYS_cpustat 26
+#define SYS_sethandoff 27
+#define SYS_clone  28
+#define SYS_join   29
+#define SYS_sbrkshared 30
+#define SYS_futex_wait 31
+#define SYS_futex_wake 32
+#define SYS_sched_setaffinity 33
+#define SYS_sched_getaffinity 34
+#define SYS_procstat 35
+#define SYS_nanosleep 36
+#define SYS_clock_gettime 37
+#define SYS_ringsetup 38
+#define SYS_ringenter 39
+#define SYS_poll 40
+#define SYS_regsnap 41
+#define SYS_sampleattach 42
+#define SYS_sampledetach 43
+#define SYS_kprof  44
+#define SYS_scstat 45
+#define SYS_trace  46
+#define SYS_lockstat 47
+#define SYS_lockbench 48
+#define SYS_setsleepspin 49
@@ -15,9 +15,31 @@
 #include "sleeplock.h"
 #include "file.h"
 #include "fcntl.h"
+#include "memlayout.h"
+#include "ring.h"
+
+// The open file for file descriptor fd, or 0.
+// Returns a new reference, so that another thread
+// closing fd can't free the file while the caller
+// uses it; the caller must fileclose() it.
+static struct file*
+fdfile(int fd)
+{
+  struct tgroup *tg = myproc()->tg;
+  struct file *f;
+
+  if(fd < 0 || fd >= NOFILE)
+    return 0;
+  acquire(&tg->lock);
+  if((f = tg->ofile[fd]) != 0)
+    filedup(f);
+  release(&tg->lock);
+  return f;
+}
 
 // Fetch the nth word-sized system call argument as a file descriptor
 // and return both the descriptor and the corresponding struct file.
+// The file is referenced as by fdfile().
 static int
 argfd(int n, int *pfd, struct file **pf)
 {
@@ -25,7 +47,7 @@ argfd(int n, int *pfd, struct file **pf)
   struct file *f;
 
   argint(n, &fd);
-  if(fd < 0 || fd >= NOFILE || (f=myproc()->ofile[fd]) == 0)
+  if((f = fdfile(fd)) == 0)
     return -1;
   if(pfd)
     *pfd = fd;
@@ -40,14 +62,17 @@ static int
 fdalloc(struct file *f)
 {
   int fd;
-  struct proc *p = myproc();
+  struct tgroup *tg = myproc()->tg;
 
+  acquire(&tg->lock);
   for(fd = 0; fd < NOFILE; fd++){
-    if(p->ofile[fd] == 0){
-      p->ofile[fd] = f;
+    if(tg->ofile[fd] == 0){
+      tg->ofile[fd] = f;
+      release(&tg->lock);
       return fd;
     }
   }
+  release(&tg->lock);
   return -1;
 }
 
@@ -59,9 +84,11 @@ sys_dup(void)
 
   if(argfd(0, 0, &f) < 0)
     return -1;
-  if((fd=fdalloc(f)) < 0)
+  // the reference from argfd goes to the new fd.
+  if((fd=fdalloc(f)) < 0){
+    fileclose(f);
     return -1;
-  filedup(f);
+  }
   return fd;
 }
 
@@ -69,21 +96,23 @@ uint64
 sys_read(void)
 {
   struct file *f;
-  int n;
+  int n, r;
   uint64 p;
 
   argaddr(1, &p);
   argint(2, &n);
   if(argfd(0, 0, &f) < 0)
     return -1;
-  return fileread(f, p, n);
+  r = fileread(f, p, n);
+  fileclose(f);
+  return r;
 }
 
 uint64
 sys_write(void)
 {
   struct file *f;
-  int n;
+  int n, r;
   uint64 p;
   
   argaddr(1, &p);
@@ -91,32 +120,52 @@ sys_write(void)
   if(argfd(0, 0, &f) < 0)
     return -1;
 
-  return filewrite(f, p, n);
+  r = filewrite(f, p, n);
+  fileclose(f);
+  return r;
 }
 
-uint64
-sys_close(void)
+static int
+fdclose(int fd)
 {
-  int fd;
   struct file *f;
+  struct tgroup *tg = myproc()->tg;
 
-  if(argfd(0, &fd, &f) < 0)
+  if(fd < 0 || fd >= NOFILE)
+    return -1;
+  // another thread may be closing fd too.
+  acquire(&tg->lock);
+  f = tg->ofile[fd];
+  tg->ofile[fd] = 0;
+  release(&tg->lock);
+  if(f == 0)
     return -1;
-  myproc()->ofile[fd] = 0;
   fileclose(f);
   return 0;
 }
 
+uint64
+sys_close(void)
+{
+  int fd;
+
+  argint(0, &fd);
+  return fdclose(fd);
+}
+
 uint64
 sys_fstat(void)
 {
   struct file *f;
   uint64 st; // user pointer to struct stat
+  int r;
 
   argaddr(1, &st);
   if(argfd(0, 0, &f) < 0)
     return -1;
-  return filestat(f, st);
+  r = filestat(f, st);
+  fileclose(f);
+  return r;
 }
 
 // Create the path new as a link to the same inode as old.
@@ -301,18 +350,12 @@ create(char *path, short type, short major, short minor)
   return 0;
 }
 
-uint64
-sys_open(void)
+static int
+fileopen(char *path, int omode)
 {
-  char path[MAXPATH];
-  int fd, omode;
+  int fd;
   struct file *f;
   struct inode *ip;
-  int n;
-
-  argint(1, &omode);
-  if((n = argstr(0, path, MAXPATH)) < 0)
-    return -1;
 
   begin_op();
 
@@ -370,6 +413,18 @@ sys_open(void)
   return fd;
 }
 
+uint64
+sys_open(void)
+{
+  char path[MAXPATH];
+  int omode;
+
+  argint(1, &omode);
+  if(argstr(0, path, MAXPATH) < 0)
+    return -1;
+  return fileopen(path, omode);
+}
+
 uint64
 sys_mkdir(void)
 {
@@ -410,7 +465,7 @@ uint64
 sys_chdir(void)
 {
   char path[MAXPATH];
-  struct inode *ip;
+  struct inode *ip, *old;
   struct proc *p = myproc();
   
   begin_op();
@@ -425,9 +480,12 @@ sys_chdir(void)
     return -1;
   }
   iunlock(ip);
-  iput(p->cwd);
+  acquire(&p->tg->lock);
+  old = p->tg->cwd;
+  p->tg->cwd = ip;
+  release(&p->tg->lock);
+  iput(old);
   end_op();
-  p->cwd = ip;
   return 0;
 }
 
@@ -481,25 +539,149 @@ sys_pipe(void)
   struct file *rf, *wf;
   int fd0, fd1;
   struct proc *p = myproc();
+  struct tgroup *tg = p->tg;
 
   argaddr(0, &fdarray);
   if(pipealloc(&rf, &wf) < 0)
     return -1;
   fd0 = -1;
   if((fd0 = fdalloc(rf)) < 0 || (fd1 = fdalloc(wf)) < 0){
-    if(fd0 >= 0)
-      p->ofile[fd0] = 0;
+    if(fd0 >= 0){
+      acquire(&tg->lock);
+      tg->ofile[fd0] = 0;
+      release(&tg->lock);
+    }
     fileclose(rf);
     fileclose(wf);
     return -1;
   }
   if(copyout(p->pagetable, fdarray, (char*)&fd0, sizeof(fd0)) < 0 ||
      copyout(p->pagetable, fdarray+sizeof(fd0), (char *)&fd1, sizeof(fd1)) < 0){
-    p->ofile[fd0] = 0;
-    p->ofile[fd1] = 0;
+    acquire(&tg->lock);
+    tg->ofile[fd0] = 0;
+    tg->ofile[fd1] = 0;
+    release(&tg->lock);
     fileclose(rf);
     fileclose(wf);
     return -1;
   }
   return 0;
 }
+
+uint64
+sys_poll(void)
+{
+  uint64 fds;
+  int n, timeout;
+
+  argaddr(0, &fds);
+  argint(1, &n);
+  argint(2, &timeout);
+  return poll(fds, n, timeout);
+}
+
+// Map the calling process's submission ring (see ring.h),
+// creating it if need be, and return its address.
+uint64
+sys_ringsetup(void)
+{
+  struct tgroup *tg = myproc()->tg;
+  struct ring *r;
+
+  acquire(&tg->lock);
+  if(tg->ring == 0){
+    if((r = (struct ring*)kalloc()) == 0){
+      release(&tg->lock);
+      return -1;
+    }
+    memset(r, 0, PGSIZE);
+    if(mappages(tg->pagetable, RING, PGSIZE, (uint64)r, PTE_R | PTE_W | PTE_U) < 0){
+      kfree((void*)r);
+      release(&tg->lock);
+      return -1;
+    }
+    tg->ring = r;
+  }
+  release(&tg->lock);
+  return RING;
+}
+
+// do one submitted operation, returning what the
+// corresponding system call would.
+static int
+ringop(struct sqe *e)
+{
+  char path[MAXPATH];
+  struct file *f;
+  int r;
+
+  switch(e->op){
+  case RING_READ:
+    if((f = fdfile(e->fd)) == 0)
+      return -1;
+    r = fileread(f, e->addr, e->n);
+    fileclose(f);
+    return r;
+  case RING_WRITE:
+    if((f = fdfile(e->fd)) == 0)
+      return -1;
+    r = filewrite(f, e->addr, e->n);
+    fileclose(f);
+    return r;
+  case RING_OPEN:
+    if(fetchstr(e->addr, path, MAXPATH) < 0)
+      return -1;
+    return fileopen(path, e->omode);
+  case RING_CLOSE:
+    return fdclose(e->fd);
+  }
+  return -1;
+}
+
+// Do up to n operations submitted to the ring, in order,
+// posting their completions. Stops early when the
+// completion ring is full.
+// Returns the number done.
+uint64
+sys_ringenter(void)
+{
+  struct proc *p = myproc();
+  struct tgroup *tg = p->tg;
+  struct ring *r;
+  struct sqe e;
+  struct cqe *c;
+  uint head, tail;
+  int n, done;
+
+  argint(0, &n);
+  acquire(&tg->lock);
+  if((r = tg->ring) == 0 || tg->ringbusy){
+    release(&tg->lock);
+    return -1;
+  }
+  // one thread at a time drains the ring.
+  tg->ringbusy = 1;
+  release(&tg->lock);
+
+  // user code writes the ring concurrently: read each
+  // index once, and copy each submission before using it.
+  head = r->sqhead;
+  tail = *(volatile uint*)&r->sqtail;
+  __sync_synchronize();
+  for(done = 0; done < n && head != tail && !killed(p); done++){
+    if(r->cqtail - *(volatile uint*)&r->cqhead >= NRING)
+      break;
+    e = r->sq[head % NRING];
+    c = &r->cq[r->cqtail % NRING];
+    c->res = ringop(&e);
+    c->data = e.data;
+    __sync_synchronize();
+    r->sqhead = ++head;
+    r->cqtail++;
+  }
+
+  acquire(&tg->lock);
+  tg->ringbusy = 0;
+  release(&tg->lock);
+  return done;
+}
@@ -5,6 +5,7 @@
 #include "memlayout.h"
 #include "spinlock.h"
 #include "proc.h"
+#include "cpustat.h"
 
 uint64
 sys_exit(void)
@@ -35,6 +36,28 @@ sys_wait(void)
   return wait(p);
 }
 
+uint64
+sys_clone(void)
+{
+  uint64 fn, arg, stack;
+
+  argaddr(0, &fn);
+  argaddr(1, &arg);
+  argaddr(2, &stack);
+  return clone(fn, arg, stack);
+}
+
+uint64
+sys_join(void)
+{
+  int tid;
+  uint64 p;
+
+  argint(0, &tid);
+  argaddr(1, &p);
+  return join(tid, p);
+}
+
 uint64
 sys_sbrk(void)
 {
@@ -42,29 +65,75 @@ sys_sbrk(void)
   int n;
 
   argint(0, &n);
-  addr = myproc()->sz;
+  addr = myproc()->tg->sz;
   if(growproc(n) < 0)
     return -1;
   return addr;
 }
 
+// like sbrk, but the new memory starts on a page
+// boundary and stays shared with children after fork.
+uint64
+sys_sbrkshared(void)
+{
+  int n;
+
+  argint(0, &n);
+  return growshared(n);
+}
+
+uint64
+sys_futex_wait(void)
+{
+  uint64 addr;
+  int val, timeout;
+
+  argaddr(0, &addr);
+  argint(1, &val);
+  argint(2, &timeout);
+  return futexwait(addr, val, timeout);
+}
+
+uint64
+sys_futex_wake(void)
+{
+  uint64 addr;
+  int n;
+
+  argaddr(0, &addr);
+  argint(1, &n);
+  return futexwake(addr, n);
+}
+
 uint64
 sys_sleep(void)
 {
   int n;
-  uint ticks0;
 
   argint(0, &n);
-  acquire(&tickslock);
-  ticks0 = ticks;
-  while(ticks - ticks0 < n){
-    if(killed(myproc())){
-      release(&tickslock);
-      return -1;
-    }
-    sleep(&ticks, &tickslock);
-  }
-  release(&tickslock);
+  if(n <= 0)
+    return 0;
+  return sleepuntil(r_time() + (uint64)n * TICKCYCLES);
+}
+
+uint64
+sys_nanosleep(void)
+{
+  uint64 ns;
+
+  argaddr(0, &ns);
+  return sleepuntil(r_time() + ns / (1000000000 / TIMEBASE));
+}
+
+uint64
+sys_clock_gettime(void)
+{
+  uint64 addr, ns;
+
+  argaddr(0, &addr);
+  ns = r_time() * (1000000000 / TIMEBASE);
+  if(copyout(myproc()->pagetable, addr, (char*)&ns, sizeof(ns)) < 0)
+    return -1;
   return 0;
 }
 
@@ -84,6 +153,7 @@ sys_uptime(void)
 {
   uint xticks;
 
+  clockintr();
   acquire(&tickslock);
   xticks = ticks;
   release(&tickslock);
@@ -105,3 +175,184 @@ uint64 sys_dump2(void)
   argaddr(2, &return_value);
   return dump2(pid, addr, return_value);
 }
+
+uint64
+sys_regsnap(void)
+{
+  uint64 pids, mask, addr;
+  int n;
+
+  argaddr(0, &pids);
+  argint(1, &n);
+  argaddr(2, &mask);
+  argaddr(3, &addr);
+  return regsnap(pids, n, mask, addr);
+}
+
+uint64
+sys_sampleattach(void)
+{
+  int pid;
+  uint64 mask;
+
+  argint(0, &pid);
+  argaddr(1, &mask);
+  return sampleattach(pid, mask);
+}
+
+uint64
+sys_sampledetach(void)
+{
+  return sampledetach();
+}
+
+uint64
+sys_kprof(void)
+{
+  int cmd, n;
+  uint64 addr;
+
+  argint(0, &cmd);
+  argaddr(1, &addr);
+  argint(2, &n);
+  return kprof(cmd, addr, n);
+}
+
+uint64
+sys_scstat(void)
+{
+  int n, reset;
+  uint64 addr;
+
+  argaddr(0, &addr);
+  argint(1, &n);
+  argint(2, &reset);
+  return scstat(addr, n, reset);
+}
+
+// Log the system calls in mask, 1 << number, made by this
+// process and the children it forks from now on, to the
+// trace device.
+uint64
+sys_trace(void)
+{
+  uint64 mask;
+
+  argaddr(0, &mask);
+  myproc()->sctrace = mask;
+  return 0;
+}
+
+uint64
+sys_lockstat(void)
+{
+  int n, reset;
+  uint64 addr;
+
+  argaddr(0, &addr);
+  argint(1, &n);
+  argint(2, &reset);
+  return lockstat(addr, n, reset);
+}
+
+uint64
+sys_lockbench(void)
+{
+  int ticket, ms;
+
+  argint(0, &ticket);
+  argint(1, &ms);
+  return lockbench(ticket, ms);
+}
+
+uint64
+sys_setpriority(void)
+{
+  int pid, nice;
+
+  argint(0, &pid);
+  argint(1, &nice);
+  return setpriority(pid, nice);
+}
+
+uint64
+sys_getpriority(void)
+{
+  int pid;
+
+  argint(0, &pid);
+  return getpriority(pid);
+}
+
+// copy statistics for up to n harts into the
+// struct cpustat array at addr.
+// returns the number of entries filled in.
+uint64
+sys_cpustat(void)
+{
+  struct cpustat cs;
+  uint64 addr;
+  int i, n;
+
+  argaddr(0, &addr);
+  argint(1, &n);
+  for(i = 0; i < n && i < NCPU; i++){
+    cs.online = cpus[i].online;
+    cs.idle = cpus[i].idletime;
+    cs.nipi = cpus[i].nipi;
+    cs.ntick = cpus[i].ntick;
+    if(copyout(myproc()->pagetable, addr + i*sizeof(cs), (char*)&cs, sizeof(cs)) < 0)
+      return -1;
+  }
+  return i;
+}
+
+uint64
+sys_sethandoff(void)
+{
+  int on;
+
+  argint(0, &on);
+  return sethandoff(on);
+}
+
+uint64
+sys_setsleepspin(void)
+{
+  int on;
+
+  argint(0, &on);
+  return setsleepspin(on);
+}
+
+uint64
+sys_sched_setaffinity(void)
+{
+  int pid, mask;
+
+  argint(0, &pid);
+  argint(1, &mask);
+  return setaffinity(pid, (uint)mask);
+}
+
+uint64
+sys_sched_getaffinity(void)
+{
+  int pid;
+
+  argint(0, &pid);
+  return getaffinity(pid);
+}
+
+// copy statistics for up to n processes into the
+// struct procstat array at addr.
+uint64
+sys_procstat(void)
+{
+  uint64 addr;
+  int n;
+
+  argaddr(0, &addr);
+  argint(1, &n);
+  return procstat(addr, n);
+}
@@ -0,0 +1,210 @@
+//
+// Timers: call a function at a given time.
+//
+// Each hart keeps its own queue of pending timers, ordered
+// by deadline, and programs its CLINT mtimecmp for whichever
+// comes first: the head of its queue or its next scheduler
+// tick. timervec in kernelvec.S turns the machine-mode timer
+// interrupt into a supervisor software interrupt, and
+// devintr() calls timerintr() to run the timers that are due.
+//
+// Sleeping processes are woken by their own timer when their
+// deadline passes, not by every tick.
+//
+// A hart stops its scheduler ticks while it is idle, or while
+// it runs a process with nothing else queued for it to run,
+// so that it is only interrupted by timers that are due.
+// sched.c restarts them when there is work to share the hart.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "timer.h"
+#include "defs.h"
+
+struct {
+  struct spinlock lock;
+  struct timer *head;   // soonest first
+} tq[NCPU];
+
+void
+timersinit(void)
+{
+  for(int i = 0; i < NCPU; i++)
+    initlock(&tq[i].lock, "timer");
+}
+
+// set this hart's mtimecmp for its next event, or to -1 if
+// there is none. caller holds tq[id].lock and is running on
+// hart id.
+static void
+program(int id)
+{
+  uint64 when = cpus[id].nexttick;
+
+  if(tq[id].head && tq[id].head->when < when)
+    when = tq[id].head->when;
+  *(uint64*)CLINT_MTIMECMP(id) = when;
+}
+
+// start this hart's scheduler ticks.
+void
+timerinithart(void)
+{
+  int id = cpuid();
+
+  acquire(&tq[id].lock);
+  mycpu()->nexttick = r_time() + TICKCYCLES;
+  program(id);
+  release(&tq[id].lock);
+}
+
+// take pending t off its queue. caller holds its lock.
+static void
+unlink(struct timer *t)
+{
+  struct timer **tp;
+
+  for(tp = &tq[t->hart].head; *tp != t; tp = &(*tp)->next)
+    ;
+  *tp = t->next;
+  t->pending = 0;
+}
+
+// Arrange for t->fn(t) to be called once the time CSR
+// reaches when, from a timer interrupt on this hart.
+// t must not be pending already.
+void
+timerstart(struct timer *t, uint64 when)
+{
+  struct timer **tp;
+  int id;
+
+  push_off();
+  id = cpuid();
+  acquire(&tq[id].lock);
+  t->when = when;
+  t->hart = id;
+  t->pending = 1;
+  for(tp = &tq[id].head; *tp && (*tp)->when <= when; tp = &(*tp)->next)
+    ;
+  t->next = *tp;
+  *tp = t;
+  if(tq[id].head == t)
+    program(id);
+  release(&tq[id].lock);
+  pop_off();
+}
+
+// Cancel t if it is still pending. Once this returns,
+// t->fn(t) isn't running, and won't be called.
+void
+timerstop(struct timer *t)
+{
+  acquire(&tq[t->hart].lock);
+  if(t->pending)
+    unlink(t);
+  release(&tq[t->hart].lock);
+}
+
+// Handle a timer interrupt: run this hart's timers that
+// are due, and program the next interrupt.
+// Returns 1 if it is time for this hart's scheduler tick.
+int
+timerintr(void)
+{
+  struct cpu *c = mycpu();
+  struct timer *t;
+  int id = cpuid(), tick = 0;
+  uint64 now = r_time();
+
+  acquire(&tq[id].lock);
+  while((t = tq[id].head) != 0 && t->when <= now){
+    tq[id].head = t->next;
+    t->pending = 0;
+    t->fn(t);
+  }
+  if(now >= c->nexttick){
+    tick = 1;
+    c->ntick++;
+    // skip ticks missed with interrupts off.
+    while(c->nexttick <= now)
+      c->nexttick += TICKCYCLES;
+  }
+  program(id);
+  release(&tq[id].lock);
+  return tick;
+}
+
+// Stop this hart's scheduler ticks.
+void
+tickstop(void)
+{
+  int id;
+
+  push_off();
+  id = cpuid();
+  acquire(&tq[id].lock);
+  cpus[id].nexttick = -1;
+  program(id);
+  release(&tq[id].lock);
+  pop_off();
+}
+
+// Restart this hart's scheduler ticks if they are stopped.
+// Called with interrupts off, under whatever locks, so it
+// doesn't take tq's lock: only this hart sets its own
+// nexttick and mtimecmp, and a timer interrupt that has
+// silenced mtimecmp meanwhile will reprogram it anyway.
+void
+tickstart(void)
+{
+  struct cpu *c = mycpu();
+  volatile uint64 *cmp;
+
+  if(c->nexttick != -1)
+    return;
+  c->nexttick = r_time() + TICKCYCLES;
+  cmp = (uint64*)CLINT_MTIMECMP(cpuid());
+  if(c->nexttick < *cmp)
+    *cmp = c->nexttick;
+}
+
+static void
+timerwake(struct timer *t)
+{
+  wakeproc(t->arg, t);
+}
+
+// Sleep until the time CSR reaches when.
+// Returns 0, or -1 if killed first.
+int
+sleepuntil(uint64 when)
+{
+  struct proc *p = myproc();
+  struct timer t;
+  int r = 0;
+
+  t.fn = timerwake;
+  t.arg = p;
+  timerstart(&t, when);
+
+  // the timer may fire before this, on this hart or, once
+  // p has moved, another; checking under the queue lock
+  // that timerwake() runs with means it can't be missed.
+  acquire(&tq[t.hart].lock);
+  while(t.pending){
+    if(killed(p)){
+      unlink(&t);
+      r = -1;
+      break;
+    }
+    sleep(&t, &tq[t.hart].lock);
+  }
+  release(&tq[t.hart].lock);
+  return r;
+}
@@ -0,0 +1,11 @@
+// A timer: fn(t) is called from a timer interrupt on the
+// hart that started it, with that hart's timer queue
+// locked, once the time CSR reaches when.
+struct timer {
+  uint64 when;                 // Deadline, in time CSR cycles
+  void (*fn)(struct timer*);   // Called when the deadline passes
+  void *arg;                   // For fn
+  int hart;                    // Whose queue it is on
+  int pending;                 // Queued, and fn not yet called?
+  struct timer *next;
+};
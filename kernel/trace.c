@@ -0,0 +1,122 @@
+//
+// Tracing: each hart records the events at the kernel's
+// tracepoints into a ring of its own, with interrupts off
+// and no locks, so tracepoints can go anywhere, even under
+// the scheduler's locks or in interrupt handlers. The trace
+// device drains the rings, one reader at a time: the hart
+// fills r->ev[head % NTRACE] and then advances head, the
+// reader copies events up to head and then advances tail,
+// and the hart drops events rather than overwrite ones the
+// reader hasn't taken.
+//
+
+#include "types.h"
+#include "param.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "proc.h"
+#include "trace.h"
+#include "defs.h"
+
+#define NTRACE 512   // events per hart
+
+uint tracemask;
+
+struct {
+  uint head;                  // advanced by the hart
+  uint tail;                  // advanced by the reader
+  uint dropped;               // since the reader last looked
+  struct traceev ev[NTRACE];
+} tr[NCPU];
+
+struct spinlock readlock;     // one reader at a time
+
+// Record an event on this hart; see TRACEPOINT().
+void
+trace(int id, uint64 a0, uint64 a1, uint64 a2, uint64 a3)
+{
+  struct traceev *e;
+  struct proc *p;
+  int cpu;
+
+  push_off();
+  cpu = cpuid();
+  p = mycpu()->proc;
+  if(tr[cpu].head - tr[cpu].tail == NTRACE){
+    __sync_fetch_and_add(&tr[cpu].dropped, 1);
+  } else {
+    e = &tr[cpu].ev[tr[cpu].head % NTRACE];
+    e->time = r_time();
+    e->cpu = cpu;
+    e->id = id;
+    e->pid = p ? p->pid : 0;
+    e->arg[0] = a0;
+    e->arg[1] = a1;
+    e->arg[2] = a2;
+    e->arg[3] = a3;
+    __sync_synchronize();
+    tr[cpu].head++;
+  }
+  pop_off();
+}
+
+// Read whole events from the harts' rings, each hart's in
+// order, reporting events a hart dropped as a TR_LOST.
+static int
+traceread(int user_dst, uint64 dst, int n)
+{
+  struct traceev lost;
+  uint head, dropped;
+  int cpu, done = 0;
+
+  n /= sizeof(struct traceev);
+  acquire(&readlock);
+  for(cpu = 0; cpu < NCPU && done < n; cpu++){
+    if((dropped = tr[cpu].dropped) != 0){
+      memset(&lost, 0, sizeof(lost));
+      lost.time = r_time();
+      lost.cpu = cpu;
+      lost.id = TR_LOST;
+      lost.arg[0] = dropped;
+      if(either_copyout(user_dst, dst + done * sizeof(lost), &lost, sizeof(lost)) < 0)
+        break;
+      // the hart may drop more meanwhile; those are reported next time.
+      __sync_fetch_and_sub(&tr[cpu].dropped, dropped);
+      done++;
+    }
+    head = tr[cpu].head;
+    __sync_synchronize();
+    for(; tr[cpu].tail != head && done < n; done++){
+      if(either_copyout(user_dst, dst + done * sizeof(struct traceev),
+                        &tr[cpu].ev[tr[cpu].tail % NTRACE], sizeof(struct traceev)) < 0)
+        break;
+      __sync_synchronize();
+      tr[cpu].tail++;
+    }
+  }
+  release(&readlock);
+  return done * sizeof(struct traceev);
+}
+
+// Choose the events to record: a uint mask of (1 << id).
+static int
+tracewrite(int user_src, uint64 src, int n)
+{
+  uint mask;
+
+  if(n != sizeof(mask) || either_copyin(&mask, user_src, src, sizeof(mask)) < 0)
+    return -1;
+  tracemask = mask & TRACEALL;
+  return n;
+}
+
+void
+traceinit(void)
+{
+  initlock(&readlock, "trace");
+  devsw[TRACE].read = traceread;
+  devsw[TRACE].write = tracewrite;
+}
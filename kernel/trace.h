@@ -0,0 +1,34 @@
+// Events recorded at the kernel's tracepoints, read from
+// the trace device. Writing a uint mask of (1 << event id)
+// to the device chooses the events recorded, 0 for none.
+struct traceev {
+  uint64 time;             // time CSR
+  ushort cpu;
+  ushort id;               // TR_*
+  int pid;                 // running on cpu, or 0
+  uint64 arg[4];
+};
+
+// event ids, and what arg[] holds
+#define TR_LOST     0      // count of events dropped on cpu
+#define TR_SWITCH   1      // pid switched to, or 0, and old state
+#define TR_SYSCALL  2      // system call number, a0, a1, a2
+#define TR_SYSRET   3      // system call number, return value
+#define TR_FAULT    4      // scause, stval
+#define TR_BREAD    5      // block number, 1 if read from disk
+#define TR_BWRITE   6      // block number
+#define TR_DISKSUB  7      // block number, 1 for a write
+#define TR_DISKDONE 8      // block number
+#define TR_COMMIT   9      // blocks in the transaction
+#define NTRACEEV    10
+
+#define TRACEALL    ((1 << NTRACEEV) - 1)
+
+// or'd into the id of a TR_SYSCALL or TR_SYSRET logged
+// because the process is being straced (see sys_trace),
+// whether or not system calls are traced in general.
+#define TR_STRACED  0x8000
+
+// record an event if it is being traced. cheap when it isn't.
+#define TRACEPOINT(id, a0, a1) \
+  do { if(tracemask & (1 << (id))) trace((id), (a0), (a1), 0, 0); } while(0)
@@ -4,10 +4,12 @@
 #include "riscv.h"
 #include "spinlock.h"
 #include "proc.h"
+#include "trace.h"
 #include "defs.h"
 
 struct spinlock tickslock;
 uint ticks;
+uint64 boottime;          // time CSR at trapinit()
 
 extern char trampoline[], uservec[], userret[];
 
@@ -15,11 +17,16 @@ extern char trampoline[], uservec[], userret[];
 void kernelvec();
 
 extern int devintr();
+static int intrdev(struct proc*);
+
+// per-CPU scratch areas for timervec, in start.c.
+extern uint64 timer_scratch[NCPU][7];
 
 void
 trapinit(void)
 {
   initlock(&tickslock, "time");
+  boottime = r_time();
 }
 
 // set up to take exceptions and traps while in the kernel.
@@ -29,6 +36,17 @@ trapinithart(void)
   w_stvec((uint64)kernelvec);
 }
 
+// charge running p's time since it last changed between
+// user and kernel, or started running, to *t.
+static void
+account(struct proc *p, uint64 *t)
+{
+  uint64 now = r_time();
+
+  *t += now - p->cpustamp;
+  p->cpustamp = now;
+}
+
 //
 // handle an interrupt, exception, or system call from user space.
 // called from trampoline.S
@@ -46,6 +64,9 @@ usertrap(void)
   w_stvec((uint64)kernelvec);
 
   struct proc *p = myproc();
+
+  // the time since returning to user space was user time.
+  account(p, &p->utime);
   
   // save user program counter.
   p->trapframe->epc = r_sepc();
@@ -65,9 +86,10 @@ usertrap(void)
     intr_on();
 
     syscall();
-  } else if((which_dev = devintr()) != 0){
+  } else if((which_dev = intrdev(p)) != 0){
     // ok
   } else {
+    TRACEPOINT(TR_FAULT, r_scause(), r_stval());
     printf("usertrap(): unexpected scause %p pid=%d\n", r_scause(), p->pid);
     printf("            sepc=%p stval=%p\n", r_sepc(), r_stval());
     setkilled(p);
@@ -76,8 +98,15 @@ usertrap(void)
   if(killed(p))
     exit(-1);
 
-  // give up the CPU if this is a timer interrupt.
-  if(which_dev == 2)
+  if(which_dev == 2){
+    kproftick(0);
+    if(p->sampler)
+      sample(p, 0);
+  }
+
+  // give up the CPU if this is a timer interrupt
+  // and the scheduler wants someone else to run.
+  if(which_dev == 2 && schedtick(p))
     yield();
 
   usertrapret();
@@ -96,6 +125,10 @@ usertrapret(void)
   // we're back in user space, where usertrap() is correct.
   intr_off();
 
+  // the time since entering the kernel was system time,
+  // including any interrupts taken in kerneltrap().
+  account(p, &p->stime);
+
   // send syscalls, interrupts, and exceptions to uservec in trampoline.S
   uint64 trampoline_uservec = TRAMPOLINE + (uservec - trampoline);
   w_stvec(trampoline_uservec);
@@ -119,14 +152,30 @@ usertrapret(void)
   // set S Exception Program Counter to the saved user pc.
   w_sepc(p->trapframe->epc);
 
-  // tell trampoline.S the user page table to switch to.
+  // tell trampoline.S the user page table to switch to,
+  // and where this thread's trapframe is mapped in it.
   uint64 satp = MAKE_SATP(p->pagetable);
 
   // jump to userret in trampoline.S at the top of memory, which 
   // switches to the user page table, restores user registers,
   // and switches to user mode with sret.
   uint64 trampoline_userret = TRAMPOLINE + (userret - trampoline);
-  ((void (*)(uint64))trampoline_userret)(satp);
+  ((void (*)(uint64,uint64))trampoline_userret)(satp, p->tfva);
+}
+
+// devintr() on behalf of p, the interrupted process, if
+// any. processes that interrupt handlers wake are none of
+// p's doing, so p shouldn't hand them its CPU in sched().
+static int
+intrdev(struct proc *p)
+{
+  struct proc *wakee = p ? p->wakee : 0;
+  int which_dev;
+
+  which_dev = devintr();
+  if(p)
+    p->wakee = wakee;
+  return which_dev;
 }
 
 // interrupts and exceptions from kernel code go here via kernelvec,
@@ -144,14 +193,22 @@ kerneltrap()
   if(intr_get() != 0)
     panic("kerneltrap: interrupts enabled");
 
-  if((which_dev = devintr()) == 0){
+  if((which_dev = intrdev(myproc())) == 0){
     printf("scause %p\n", scause);
     printf("sepc=%p stval=%p\n", r_sepc(), r_stval());
     panic("kerneltrap");
   }
 
-  // give up the CPU if this is a timer interrupt.
-  if(which_dev == 2 && myproc() != 0 && myproc()->state == RUNNING)
+  if(which_dev == 2){
+    kproftick(sepc);
+    if(myproc() != 0 && myproc()->sampler)
+      sample(myproc(), 1);
+  }
+
+  // give up the CPU if this is a timer interrupt
+  // and the scheduler wants someone else to run.
+  if(which_dev == 2 && myproc() != 0 && myproc()->state == RUNNING &&
+     schedtick(myproc()))
     yield();
 
   // the yield() may have caused some traps to occur,
@@ -160,13 +217,35 @@ kerneltrap()
   w_sstatus(sstatus);
 }
 
+// Bring ticks up to date with the time CSR. Any hart that
+// is ticking calls this, since harts stop their ticks while
+// idle or running a single process, possibly all at once.
 void
-clockintr()
+clockintr(void)
 {
+  uint now;
+  int boost = 0;
+
   acquire(&tickslock);
-  ticks++;
-  wakeup(&ticks);
+  now = (r_time() - boottime) / TICKCYCLES;
+  while(ticks != now){
+    ticks++;
+    if(ticks % BOOSTTICKS == 0)
+      boost = 1;
+  }
   release(&tickslock);
+
+  if(boost)
+    runqboost();
+}
+
+// Send an inter-processor interrupt to hart, waking it
+// from wfi. It arrives as a machine-mode software interrupt,
+// which timervec forwards as a supervisor one.
+void
+ipi(int hart)
+{
+  *(uint32*)CLINT_MSIP(hart) = 1;
 }
 
 // check if it's an external interrupt or software interrupt,
@@ -202,17 +281,32 @@ devintr()
 
     return 1;
   } else if(scause == 0x8000000000000001L){
-    // software interrupt from a machine-mode timer interrupt,
-    // forwarded by timervec in kernelvec.S.
+    // software interrupt from a machine-mode timer interrupt
+    // or IPI, forwarded by timervec in kernelvec.S.
+    int id = cpuid();
 
-    if(cpuid() == 0){
-      clockintr();
-    }
-    
     // acknowledge the software interrupt by clearing
     // the SSIP bit in sip.
     w_sip(r_sip() & ~2);
 
+    // an IPI wakes this hart up, or tells it to restart
+    // its ticks because there is now more than one
+    // process for it to run. it and a timer tick may have
+    // arrived together.
+    if(__sync_lock_test_and_set(&timer_scratch[id][4], 0) != 0){
+      mycpu()->nipi++;
+      tickstart();
+    }
+    if(__sync_lock_test_and_set(&timer_scratch[id][5], 0) == 0)
+      return 1;
+
+    // run due timers; the periodic tick only drives
+    // the clock and preemption when it is due itself.
+    if(timerintr() == 0)
+      return 1;
+
+    clockintr();
+
     return 2;
   } else {
     return 0;
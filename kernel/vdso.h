@@ -0,0 +1,11 @@
+// The page the kernel maps read-only at VDSO in every
+// process, so user code can find these without a system
+// call. The tick count and the time are derived from the
+// time CSR, which user code can read, with boottime and
+// the rates here; see vdso_uptime() in user/ulib.c.
+struct vdso {
+  uint64 boottime;    // time CSR when ticks started counting
+  uint64 tickcycles;  // time CSR cycles per tick
+  uint64 timebase;    // time CSR cycles per second
+  int pid;            // getpid(), or 0 once the process has threads
+};
@@ -5,6 +5,8 @@
 #include "riscv.h"
 #include "defs.h"
 #include "fs.h"
+#include "spinlock.h"
+#include "proc.h"
 
 /*
  * the kernel's page table.
@@ -30,6 +32,9 @@ kvmmake(void)
   // virtio mmio disk interface
   kvmmap(kpgtbl, VIRTIO0, VIRTIO0, PGSIZE, PTE_R | PTE_W);
 
+  // CLINT, for sending inter-processor interrupts.
+  kvmmap(kpgtbl, CLINT, CLINT, 0x10000, PTE_R | PTE_W);
+
   // PLIC
   kvmmap(kpgtbl, PLIC, PLIC, 0x400000, PTE_R | PTE_W);
 
@@ -43,9 +48,9 @@ kvmmake(void)
   // the highest virtual address in the kernel.
   kvmmap(kpgtbl, TRAMPOLINE, (uint64)trampoline, PGSIZE, PTE_R | PTE_X);
 
-  // allocate and map a kernel stack for each process.
-  proc_mapstacks(kpgtbl);
-  
+  // process kernel stacks are mapped later, on demand,
+  // by kvmmapstack().
+
   return kpgtbl;
 }
 
@@ -135,6 +140,40 @@ kvmmap(pagetable_t kpgtbl, uint64 va, uint64 pa, uint64 sz, int perm)
     panic("kvmmap");
 }
 
+// bumped each time a kernel stack is mapped; see kvmsync().
+uint kstackgen;
+
+// map the kernel stack page pa at va in the kernel page table,
+// for allocproc() growing the process table after boot.
+// the page below va is left unmapped as a guard page.
+// returns 0 on success, -1 if a page-table page couldn't be allocated.
+int
+kvmmapstack(uint64 va, uint64 pa)
+{
+  if(mappages(kernel_pagetable, va, PGSIZE, pa, PTE_R | PTE_W) != 0)
+    return -1;
+
+  // other harts may have cached the invalid PTE; they
+  // flush before running a proc, in kvmsync().
+  __sync_fetch_and_add(&kstackgen, 1);
+  return 0;
+}
+
+// flush this hart's TLB if a kernel stack has been mapped
+// since it last did, so it can switch to any proc.
+// called with interrupts off.
+void
+kvmsync(void)
+{
+  struct cpu *c = mycpu();
+  uint gen = __atomic_load_n(&kstackgen, __ATOMIC_ACQUIRE);
+
+  if(c->kstackgen != gen){
+    sfence_vma();
+    c->kstackgen = gen;
+  }
+}
+
 // Create PTEs for virtual addresses starting at va that refer to
 // physical addresses starting at pa. va and size might not
 // be page-aligned. Returns 0 on success, -1 if walk() couldn't
@@ -317,6 +356,13 @@ uvmcopy(pagetable_t old, pagetable_t new, uint64 sz)
       panic("uvmcopy: page not present");
     pa = PTE2PA(*pte);
     flags = PTE_FLAGS(*pte);
+    if(flags & PTE_S){
+      // map the same page in the child.
+      if(mappages(new, i, PGSIZE, pa, flags) != 0)
+        goto err;
+      kref((void*)pa);
+      continue;
+    }
     if((mem = kalloc()) == 0)
       goto err;
     memmove(mem, (char*)pa, PGSIZE);
@@ -0,0 +1,124 @@
+// affinitybench: a memory-bound worker, migrating or pinned.
+//
+// starts nhogs CPU-bound processes, then times a worker
+// that sweeps a kb-kilobyte buffer passes times, twice:
+// first with everything free to run on any hart, so the
+// worker keeps moving between harts and finds its cache
+// and TLB entries cold, then with the worker pinned to
+// the first hart and the hogs kept off it. run it with
+// more hogs than harts, e.g. CPUS=2 and 3 hogs.
+//
+//   affinitybench [nhogs [kb [passes]]]
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/cpustat.h"
+#include "user/user.h"
+
+#define MAXHOGS 32
+
+int nhogs = 3, kb = 256, passes = 200;
+int hogs[MAXHOGS];
+
+static void
+starthogs(int mask)
+{
+  for(int i = 0; i < nhogs; i++){
+    if((hogs[i] = fork()) < 0){
+      fprintf(2, "affinitybench: fork failed\n");
+      exit(1);
+    }
+    if(hogs[i] == 0){
+      volatile uint64 n = 0;
+      sched_setaffinity(0, mask);
+      for(;;)
+        n++;
+    }
+  }
+}
+
+static void
+stophogs(void)
+{
+  for(int i = 0; i < nhogs; i++)
+    kill(hogs[i]);
+  for(int i = 0; i < nhogs; i++)
+    wait(0);
+}
+
+// sweep the buffer in a child with the given affinity,
+// and return the ticks it took.
+static int
+worker(int mask)
+{
+  int t0, pid, xstate;
+
+  t0 = uptime();
+  if((pid = fork()) < 0){
+    fprintf(2, "affinitybench: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    int n = kb * 1024 / sizeof(uint64);
+    volatile uint64 *buf;
+
+    if(sched_setaffinity(0, mask) < 0)
+      exit(1);
+    if((buf = (uint64*)sbrk(n * sizeof(uint64))) == (uint64*)-1)
+      exit(1);
+    for(int k = 0; k < passes; k++)
+      for(int i = 0; i < n; i += 8)   // a 64-byte line at a time
+        buf[i]++;
+    exit(0);
+  }
+  wait(&xstate);
+  if(xstate != 0){
+    fprintf(2, "affinitybench: worker failed\n");
+    exit(1);
+  }
+  return uptime() - t0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct cpustat cs[NCPU];
+  int i, n, all = 0, first = -1, free, pinned;
+
+  if(argc > 1)
+    nhogs = atoi(argv[1]);
+  if(argc > 2)
+    kb = atoi(argv[2]);
+  if(argc > 3)
+    passes = atoi(argv[3]);
+  if(nhogs > MAXHOGS)
+    nhogs = MAXHOGS;
+
+  if((n = cpustat(cs, NCPU)) < 0){
+    fprintf(2, "affinitybench: cpustat failed\n");
+    exit(1);
+  }
+  for(i = 0; i < n; i++){
+    if(cs[i].online){
+      all |= 1 << i;
+      if(first < 0)
+        first = i;
+    }
+  }
+  if(all == (1 << first)){
+    fprintf(2, "affinitybench: needs more than one hart\n");
+    exit(1);
+  }
+
+  starthogs(all);
+  free = worker(all);
+  stophogs();
+
+  starthogs(all & ~(1 << first));
+  pinned = worker(1 << first);
+  stophogs();
+
+  printf("affinitybench: %d hogs, %d KB x %d passes: free %d ticks, pinned to hart %d %d ticks\n",
+         nhogs, kb, passes, free, first, pinned);
+  exit(0);
+}
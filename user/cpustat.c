@@ -0,0 +1,32 @@
+// cpustat: report how much of the time since boot
+// each hart has spent idle, and how many scheduler
+// ticks it has taken.
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/cpustat.h"
+#include "user/user.h"
+
+int
+main(void)
+{
+  struct cpustat cs[NCPU];
+  uint64 total;
+  int i, n;
+
+  if((n = cpustat(cs, NCPU)) < 0){
+    fprintf(2, "cpustat: failed\n");
+    exit(1);
+  }
+  total = (uint64)uptime() * TICKCYCLES;
+  if(total == 0)
+    total = 1;
+  for(i = 0; i < n; i++){
+    if(!cs[i].online)
+      continue;
+    printf("hart %d: idle %l ticks (%l%%), %l wakeup IPIs, %l of %d ticks taken\n", i,
+           cs[i].idle / TICKCYCLES, cs[i].idle * 100 / total, cs[i].nipi,
+           cs[i].ntick, uptime());
+  }
+  exit(0);
+}
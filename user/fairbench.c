@@ -0,0 +1,94 @@
+// fairbench: CPU share and throughput of competing workers.
+//
+// forks one CPU-bound worker per nice value given on the
+// command line (default: 0 0 5 10), lets them run for a
+// fixed number of ticks, and reports how many loop
+// iterations each managed, as a share of the total. build
+// the kernel with make SCHED=rr, mlfq or fair to compare.
+//
+//   fairbench [-t ticks] [nice...]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define MAXWORKERS 16
+
+int
+snice(char *s)
+{
+  return s[0] == '-' ? -atoi(s+1) : atoi(s);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nices[MAXWORKERS] = { 0, 0, 5, 10 };
+  int nw = 4, duration = 100, i, start;
+  int fds[2];
+  uint64 counts[MAXWORKERS], total;
+
+  if(argc > 2 && strcmp(argv[1], "-t") == 0){
+    duration = atoi(argv[2]);
+    argv += 2;
+    argc -= 2;
+  }
+  if(argc > 1){
+    for(nw = 0; nw < MAXWORKERS && nw+1 < argc; nw++)
+      nices[nw] = snice(argv[nw+1]);
+  }
+
+  if(pipe(fds) < 0){
+    fprintf(2, "fairbench: pipe failed\n");
+    exit(1);
+  }
+
+  // all workers spin until the same deadline, then
+  // report their iteration count through the pipe.
+  start = uptime() + 2;
+  for(i = 0; i < nw; i++){
+    int pid = fork();
+    if(pid < 0){
+      fprintf(2, "fairbench: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      uint64 msg[2];
+      volatile uint64 n = 0;
+
+      setpriority(0, nices[i]);
+      while(uptime() < start)
+        ;
+      while(uptime() < start + duration)
+        for(int j = 0; j < 1000; j++)
+          n++;
+      msg[0] = i;
+      msg[1] = n;
+      write(fds[1], msg, sizeof(msg));
+      exit(0);
+    }
+  }
+  close(fds[1]);
+
+  total = 0;
+  for(i = 0; i < nw; i++){
+    uint64 msg[2];
+    if(read(fds[0], msg, sizeof(msg)) != sizeof(msg)){
+      fprintf(2, "fairbench: short read\n");
+      exit(1);
+    }
+    counts[msg[0]] = msg[1];
+    total += msg[1];
+  }
+  for(i = 0; i < nw; i++)
+    wait(0);
+  if(total == 0)
+    total = 1;
+
+  printf("fairbench: %d workers, %d ticks, %l iterations in all\n",
+         nw, duration, total);
+  for(i = 0; i < nw; i++)
+    printf("  nice %d: %l iterations, %l.%l%%\n", nices[i], counts[i],
+           counts[i] * 100 / total, (counts[i] * 1000 / total) % 10);
+  exit(0);
+}
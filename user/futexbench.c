@@ -0,0 +1,127 @@
+// futexbench: lock contention between processes.
+//
+// nprocs forked processes each increment a counter in a
+// page from sbrkshared() iters times, holding a lock for
+// each increment. the lock is first a spinlock that backs
+// off with sleep(1), the only way to wait before futexes,
+// then a futex-based mutex. reports the ticks each took.
+// then two processes take turns using a condition
+// variable, and the rate of turns is reported.
+//
+//   futexbench [nprocs [iters [turns]]]
+
+#include "kernel/types.h"
+#include "user/user.h"
+
+struct shared {
+  struct mutex m;
+  struct cond c;
+  int spin;
+  int counter;
+  int turn;
+};
+
+struct shared *sh;
+
+static void
+spinlock(void)
+{
+  while(__sync_lock_test_and_set(&sh->spin, 1) != 0)
+    sleep(1);
+  __sync_synchronize();
+}
+
+static void
+spinunlock(void)
+{
+  __sync_synchronize();
+  __sync_lock_release(&sh->spin);
+}
+
+// run nprocs workers doing iters locked increments each,
+// and return how many ticks they took.
+static int
+contend(int usefutex, int nprocs, int iters)
+{
+  int i, j, t0;
+  volatile int k;
+
+  sh->counter = 0;
+  t0 = uptime();
+  for(i = 0; i < nprocs; i++){
+    int pid = fork();
+    if(pid < 0){
+      fprintf(2, "futexbench: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      for(j = 0; j < iters; j++){
+        if(usefutex)
+          mutex_lock(&sh->m);
+        else
+          spinlock();
+        sh->counter++;
+        // hold the lock for a little while.
+        for(k = 0; k < 100; k++)
+          ;
+        if(usefutex)
+          mutex_unlock(&sh->m);
+        else
+          spinunlock();
+      }
+      exit(0);
+    }
+  }
+  for(i = 0; i < nprocs; i++)
+    wait(0);
+  if(sh->counter != nprocs * iters){
+    fprintf(2, "futexbench: counter %d, want %d\n", sh->counter, nprocs * iters);
+    exit(1);
+  }
+  return uptime() - t0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nprocs = 4, iters = 2000, turns = 2000, i, pid, t, t0;
+
+  if(argc > 1)
+    nprocs = atoi(argv[1]);
+  if(argc > 2)
+    iters = atoi(argv[2]);
+  if(argc > 3)
+    turns = atoi(argv[3]);
+
+  if((sh = (struct shared*)sbrkshared(sizeof(*sh))) == (struct shared*)-1){
+    fprintf(2, "futexbench: sbrkshared failed\n");
+    exit(1);
+  }
+
+  t = contend(0, nprocs, iters);
+  printf("futexbench: %d procs x %d: sleep(1) spinlock %d ticks\n", nprocs, iters, t);
+  t = contend(1, nprocs, iters);
+  printf("futexbench: %d procs x %d: futex mutex %d ticks\n", nprocs, iters, t);
+
+  // take turns: each waits for the other to hand over.
+  sh->turn = 0;
+  t0 = uptime();
+  if((pid = fork()) < 0){
+    fprintf(2, "futexbench: fork failed\n");
+    exit(1);
+  }
+  mutex_lock(&sh->m);
+  for(i = 0; i < turns; i++){
+    while(sh->turn != (pid == 0))
+      cond_wait(&sh->c, &sh->m);
+    sh->turn = (pid != 0);
+    cond_broadcast(&sh->c);
+  }
+  mutex_unlock(&sh->m);
+  if(pid == 0)
+    exit(0);
+  wait(0);
+  t = uptime() - t0;
+  printf("futexbench: %d condvar turns each in %d ticks\n", turns, t);
+  exit(0);
+}
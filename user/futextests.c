@@ -0,0 +1,132 @@
+#include "kernel/types.h"
+#include "user/user.h"
+
+int success;
+
+void test1();
+void test2();
+void test3();
+void test4();
+
+int main(void) {
+  printf("futex tests started\n");
+  success = 0;
+  test1();
+  test2();
+  test3();
+  test4();
+  printf("4 tests were run. %d tests passed\n", success);
+  exit(0);
+}
+
+void test1() {
+  printf("test 1 started\n");
+  int *w = (int *)sbrkshared(4096);
+  int status = -1, woken = 0;
+  *w = 0;
+  int child_proc = fork();
+  if (child_proc == 0) {
+    exit(futex_wait(w, 0, 0));
+  }
+  // wake the child once it is waiting.
+  for (int i = 0; i < 100 && woken == 0; i++) {
+    sleep(1);
+    woken = futex_wake(w, 1);
+  }
+  if (woken != 1) {
+    printf("[ERROR] futex_wake returned %d, expected 1\n", woken);
+    kill(child_proc);
+    wait(0);
+    goto failed;
+  }
+  wait(&status);
+  if (status != 0) {
+    printf("[ERROR] futex_wait returned %d, expected 0\n", status);
+    goto failed;
+  }
+  woken = futex_wake(w, 1);
+  if (woken != 0) {
+    printf("[ERROR] futex_wake with no waiters returned %d\n", woken);
+    goto failed;
+  }
+  printf("[SUCCESS] test 1 passed\n");
+  success++;
+failed:
+  printf("test 1 finished\n");
+}
+
+void test2() {
+  printf("test 2 started\n");
+  int w = 0;
+  int t0 = uptime();
+  int r = futex_wait(&w, 0, 2);
+  if (r != 1) {
+    printf("[ERROR] futex_wait returned %d, expected 1\n", r);
+    goto failed;
+  }
+  if (uptime() - t0 < 1) {
+    printf("[ERROR] futex_wait timed out too soon\n");
+    goto failed;
+  }
+  printf("[SUCCESS] test 2 passed\n");
+  success++;
+failed:
+  printf("test 2 finished\n");
+}
+
+void test3() {
+  printf("test 3 started\n");
+  int w = 5;
+  int r = futex_wait(&w, 0, 0);
+  if (r != -1) {
+    printf("[ERROR] futex_wait returned %d, expected -1\n", r);
+    goto failed;
+  }
+  r = futex_wait((int *)0x7ffffff000L, 0, 0);
+  if (r != -1) {
+    printf("[ERROR] futex_wait on a bad address returned %d\n", r);
+    goto failed;
+  }
+  printf("[SUCCESS] test 3 passed\n");
+  success++;
+failed:
+  printf("test 3 finished\n");
+}
+
+#define NTHR 4
+#define NINC 1000
+
+struct mutex m;
+int count;
+
+void inc(void *arg) {
+  for (int i = 0; i < NINC; i++) {
+    mutex_lock(&m);
+    count++;
+    mutex_unlock(&m);
+  }
+}
+
+void test4() {
+  printf("test 4 started\n");
+  int tids[NTHR], n;
+  mutex_init(&m);
+  count = 0;
+  for (n = 0; n < NTHR; n++)
+    if ((tids[n] = thread_create(inc, 0)) < 0)
+      break;
+  for (int i = 0; i < n; i++)
+    thread_join(tids[i]);
+  if (n != NTHR) {
+    printf("[ERROR] thread_create failed\n");
+    goto failed;
+  }
+  if (count != NTHR * NINC) {
+    printf("[ERROR] count %d, expected %d\n", count, NTHR * NINC);
+    goto failed;
+  }
+  printf("[SUCCESS] test 4 passed\n");
+  success++;
+failed:
+  printf("test 4 finished\n");
+}
@@ -20,6 +20,7 @@ main(void)
     mknod("console", CONSOLE, 0);
     open("console", O_RDWR);
   }
+  mknod("trace", TRACE, 0);
   dup(0);  // stdout
   dup(0);  // stderr
 
@@ -0,0 +1,103 @@
+// lockbench: spin lock throughput and fairness.
+//
+// starts a process pinned to each hart, and has them all
+// take and release one kernel lock as fast as they can for
+// ms milliseconds, with lockbench(), twice: an ordinary
+// test-and-set spin lock, then a ticket lock. reports the
+// acquisitions per second in all, each hart's share, and
+// Jain's fairness index: 100% when every hart got the lock
+// equally often, down to 100/n% when one hart got it all.
+// run it with CPUS=8 or so.
+//
+//   lockbench [ms]
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/cpustat.h"
+#include "kernel/lockstat.h"
+#include "user/user.h"
+
+int ms = 1000;
+int harts[NCPU], nhart;
+
+static void
+run(char *name, int ticket)
+{
+  int go[2], res[2], count[NCPU], i, c[2];
+  uint64 sum = 0, sumsq = 0;
+
+  pipe(go);
+  pipe(res);
+  for(i = 0; i < nhart; i++){
+    int pid = fork();
+    if(pid < 0){
+      fprintf(2, "lockbench: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      char ch;
+      close(go[1]);
+      close(res[0]);
+      sched_setaffinity(0, 1 << harts[i]);
+      read(go[0], &ch, 1);
+      c[0] = i;
+      c[1] = lockbench(ticket, ms);
+      write(res[1], c, sizeof(c));
+      exit(0);
+    }
+  }
+  close(go[0]);
+  close(res[1]);
+  // give them time to get onto their harts.
+  sleep(2);
+  close(go[1]);
+  for(i = 0; i < nhart; i++){
+    if(read(res[0], c, sizeof(c)) != sizeof(c)){
+      fprintf(2, "lockbench: lost a worker\n");
+      exit(1);
+    }
+    count[c[0]] = c[1];
+  }
+  close(res[0]);
+  for(i = 0; i < nhart; i++)
+    wait(0);
+
+  printf("lockbench: %s:", name);
+  for(i = 0; i < nhart; i++){
+    sum += count[i];
+    sumsq += (uint64)count[i] * count[i];
+  }
+  if(sum == 0)
+    sum = 1;
+  for(i = 0; i < nhart; i++)
+    printf(" %d%%", (int)(count[i] * 100 / sum));
+  printf("\nlockbench: %s: %l acquires/s, fairness %d%%\n", name,
+         sum * 1000 / ms, sumsq ? (int)(sum * sum * 100 / (nhart * sumsq)) : 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct cpustat cs[NCPU];
+  int i, n;
+
+  if(argc > 1)
+    ms = atoi(argv[1]);
+  if(ms < 1)
+    ms = 1;
+  if(ms > LOCKBENCHMS)
+    ms = LOCKBENCHMS;
+
+  if((n = cpustat(cs, NCPU)) < 0){
+    fprintf(2, "lockbench: cpustat failed\n");
+    exit(1);
+  }
+  for(i = 0; i < n; i++)
+    if(cs[i].online)
+      harts[nhart++] = i;
+
+  printf("lockbench: %d harts, %d ms; each hart's share of acquires:\n", nhart, ms);
+  run("spin", 0);
+  run("ticket", 1);
+  exit(0);
+}
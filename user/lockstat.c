@@ -0,0 +1,81 @@
+// lockstat: spin lock contention.
+//
+// lists the kernel's spin locks by name, most contended
+// first: how many locks have the name, acquisitions, how
+// many had to spin and what percentage that is, the spin
+// loop iterations in all, and the longest any was held,
+// in ns. with prog, clears the statistics, runs prog with
+// its arguments, and lists what happened while it ran;
+// otherwise lists everything since boot or the last -r,
+// which clears them after listing.
+//
+//   lockstat [-r] [prog [args...]]
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/lockstat.h"
+#include "user/user.h"
+
+#define MAXCLASS 64
+#define NS(t) ((t) * (1000000000 / TIMEBASE))
+
+struct lockstat ls[MAXCLASS];
+int order[MAXCLASS];
+
+// does a belong ahead of b?
+static int
+ahead(struct lockstat *a, struct lockstat *b)
+{
+  if(a->ncontend != b->ncontend)
+    return a->ncontend > b->ncontend;
+  return a->nacquire > b->nacquire;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, k, n, pid, reset = 0;
+  struct lockstat *l;
+
+  if(argc > 1 && strcmp(argv[1], "-r") == 0){
+    reset = 1;
+    argc--;
+    argv++;
+  }
+  if(argc > 1){
+    lockstat(ls, 0, 1);
+    if((pid = fork()) < 0){
+      fprintf(2, "lockstat: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      exec(argv[1], argv + 1);
+      fprintf(2, "lockstat: exec %s failed\n", argv[1]);
+      exit(1);
+    }
+    wait(0);
+  }
+  if((n = lockstat(ls, MAXCLASS, reset)) < 0){
+    fprintf(2, "lockstat: lockstat failed\n");
+    exit(1);
+  }
+  if(n > MAXCLASS)
+    n = MAXCLASS;
+
+  for(i = 0; i < n; i++){
+    for(k = i; k > 0 && ahead(&ls[i], &ls[order[k-1]]); k--)
+      order[k] = order[k-1];
+    order[k] = i;
+  }
+
+  printf("name\t\tlocks\tacquire\tcontend\t%%\tspins\tmaxhold(ns)\n");
+  for(k = 0; k < n; k++){
+    l = &ls[order[k]];
+    if(l->nacquire == 0)
+      continue;
+    printf("%s\t%s%d\t%l\t%l\t%d\t%l\t%l\n", l->name, strlen(l->name) < 8 ? "\t" : "",
+           l->nlocks, l->nacquire, l->ncontend, (int)(l->ncontend * 100 / l->nacquire),
+           l->spins, NS(l->maxhold));
+  }
+  exit(0);
+}
@@ -0,0 +1,30 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+// nice: run a command with a different scheduling priority.
+//   nice [-n inc] command [args...]
+// inc defaults to 10; negative values favour the command.
+
+int
+main(int argc, char **argv)
+{
+  int inc = 10;
+  char *s;
+
+  if(argc > 2 && strcmp(argv[1], "-n") == 0){
+    s = argv[2];
+    inc = (s[0] == '-') ? -atoi(s+1) : atoi(s);
+    argv += 2;
+    argc -= 2;
+  }
+  if(argc < 2){
+    fprintf(2, "usage: nice [-n inc] command [args...]\n");
+    exit(1);
+  }
+
+  nice(inc);
+  exec(argv[1], argv+1);
+  fprintf(2, "nice: exec %s failed\n", argv[1]);
+  exit(1);
+}
@@ -0,0 +1,147 @@
+// pollbench: fan in from many pipes.
+//
+// nsrc writer processes each send nmsg messages down a pipe
+// of their own, and one reader collects them all, twice:
+// first without poll(), the only way being a relay process
+// per pipe copying into one shared pipe, then with the
+// reader poll()ing all the pipes itself. reports the time
+// each took.
+//
+//   pollbench [nsrc [nmsg]]
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/poll.h"
+#include "user/user.h"
+
+#define MSGSIZE 16
+#define MAXSRC (NOFILE - 5)  // leaving stdin, stdout, stderr and a pipe
+
+int nsrc = 8, nmsg = 500;
+int fds[MAXSRC];
+
+// start the writers, one pipe each, leaving the read
+// ends in fds[].
+static void
+writers(void)
+{
+  char msg[MSGSIZE];
+  int p[2];
+
+  memset(msg, 'm', sizeof(msg));
+  for(int i = 0; i < nsrc; i++){
+    if(pipe(p) < 0){
+      fprintf(2, "pollbench: pipe failed\n");
+      exit(1);
+    }
+    if(fork() == 0){
+      for(int j = 0; j < i; j++)
+        close(fds[j]);
+      close(p[0]);
+      for(int k = 0; k < nmsg; k++)
+        write(p[1], msg, sizeof(msg));
+      exit(0);
+    }
+    close(p[1]);
+    fds[i] = p[0];
+  }
+}
+
+// read everything with a relay process per pipe; returns
+// the bytes read.
+static int
+relay(void)
+{
+  char buf[MSGSIZE * 8];
+  int p[2], n, total = 0;
+
+  if(pipe(p) < 0){
+    fprintf(2, "pollbench: pipe failed\n");
+    exit(1);
+  }
+  for(int i = 0; i < nsrc; i++){
+    if(fork() == 0){
+      close(p[0]);
+      while((n = read(fds[i], buf, sizeof(buf))) > 0)
+        write(p[1], buf, n);
+      exit(0);
+    }
+  }
+  close(p[1]);
+  for(int i = 0; i < nsrc; i++)
+    close(fds[i]);
+  while((n = read(p[0], buf, sizeof(buf))) > 0)
+    total += n;
+  close(p[0]);
+  for(int i = 0; i < nsrc; i++)
+    wait(0);
+  return total;
+}
+
+// read everything by polling the pipes; returns the
+// bytes read.
+static int
+polled(void)
+{
+  struct pollfd pfd[MAXSRC];
+  char buf[MSGSIZE * 8];
+  int n, open = nsrc, total = 0;
+
+  for(int i = 0; i < nsrc; i++){
+    pfd[i].fd = fds[i];
+    pfd[i].events = POLLIN;
+  }
+  while(open > 0){
+    if(poll(pfd, nsrc, -1) < 0){
+      fprintf(2, "pollbench: poll failed\n");
+      exit(1);
+    }
+    for(int i = 0; i < nsrc; i++){
+      if((pfd[i].revents & (POLLIN | POLLHUP)) == 0)
+        continue;
+      if((n = read(pfd[i].fd, buf, sizeof(buf))) > 0){
+        total += n;
+      } else {
+        close(pfd[i].fd);
+        pfd[i].fd = -1;
+        open--;
+      }
+    }
+  }
+  return total;
+}
+
+static void
+run(char *name, int usepoll)
+{
+  uint64 t0, t1;
+  int total;
+
+  t0 = vdso_clock();
+  writers();
+  total = usepoll ? polled() : relay();
+  for(int i = 0; i < nsrc; i++)
+    wait(0);
+  t1 = vdso_clock();
+  if(total != nsrc * nmsg * MSGSIZE){
+    fprintf(2, "pollbench: %s: read %d bytes, want %d\n", name, total, nsrc * nmsg * MSGSIZE);
+    exit(1);
+  }
+  printf("pollbench: %s: %l us\n", name, (t1 - t0) / 1000);
+}
+
+int
+main(int argc, char *argv[])
+{
+  if(argc > 1)
+    nsrc = atoi(argv[1]);
+  if(argc > 2)
+    nmsg = atoi(argv[2]);
+  if(nsrc < 1 || nsrc > MAXSRC)
+    nsrc = MAXSRC;
+
+  printf("pollbench: %d pipes x %d messages of %d bytes\n", nsrc, nmsg, MSGSIZE);
+  run("relay processes", 0);
+  run("poll", 1);
+  exit(0);
+}
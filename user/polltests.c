@@ -0,0 +1,150 @@
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/poll.h"
+#include "user/user.h"
+
+int success;
+
+void test1();
+void test2();
+void test3();
+void test4();
+void test5();
+
+int main(void) {
+  printf("poll tests started\n");
+  success = 0;
+  test1();
+  test2();
+  test3();
+  test4();
+  test5();
+  printf("5 tests were run. %d tests passed\n", success);
+  exit(0);
+}
+
+// poll the one fd for events; returns poll()'s result
+// and sets *revents.
+int poll1(int fd, int events, int timeout, int *revents) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = events;
+  pfd.revents = 0;
+  int r = poll(&pfd, 1, timeout);
+  *revents = pfd.revents;
+  return r;
+}
+
+void test1() {
+  printf("test 1 started\n");
+  int fds[2], rev;
+  pipe(fds);
+  int r = poll1(fds[0], POLLIN, 0, &rev);
+  if (r != 0 || rev != 0) {
+    printf("[ERROR] empty pipe: poll %d revents %x, expected 0 0\n", r, rev);
+    goto failed;
+  }
+  r = poll1(fds[1], POLLOUT, 0, &rev);
+  if (r != 1 || rev != POLLOUT) {
+    printf("[ERROR] write end: poll %d revents %x, expected 1 %x\n", r, rev,
+           POLLOUT);
+    goto failed;
+  }
+  write(fds[1], "x", 1);
+  r = poll1(fds[0], POLLIN | POLLOUT, 0, &rev);
+  if (r != 1 || rev != POLLIN) {
+    printf("[ERROR] pipe with data: poll %d revents %x, expected 1 %x\n", r, rev,
+           POLLIN);
+    goto failed;
+  }
+  printf("[SUCCESS] test 1 passed\n");
+  success++;
+failed:
+  close(fds[0]);
+  close(fds[1]);
+  printf("test 1 finished\n");
+}
+
+void test2() {
+  printf("test 2 started\n");
+  int fds[2], rev;
+  pipe(fds);
+  close(fds[1]);
+  int r = poll1(fds[0], POLLIN, 0, &rev);
+  if (r != 1 || (rev & POLLHUP) == 0) {
+    printf("[ERROR] poll %d revents %x, expected 1 with POLLHUP\n", r, rev);
+    goto failed;
+  }
+  printf("[SUCCESS] test 2 passed\n");
+  success++;
+failed:
+  close(fds[0]);
+  printf("test 2 finished\n");
+}
+
+void test3() {
+  printf("test 3 started\n");
+  int rev;
+  close(NOFILE - 1);
+  int r = poll1(NOFILE - 1, POLLIN, 0, &rev);
+  if (r != 1 || rev != POLLNVAL) {
+    printf("[ERROR] closed fd: poll %d revents %x, expected 1 %x\n", r, rev,
+           POLLNVAL);
+    goto failed;
+  }
+  r = poll1(-1, POLLIN, 0, &rev);
+  if (r != 0 || rev != 0) {
+    printf("[ERROR] fd -1: poll %d revents %x, expected 0 0\n", r, rev);
+    goto failed;
+  }
+  printf("[SUCCESS] test 3 passed\n");
+  success++;
+failed:
+  printf("test 3 finished\n");
+}
+
+void test4() {
+  printf("test 4 started\n");
+  int fds[2], rev;
+  pipe(fds);
+  int t0 = uptime();
+  int r = poll1(fds[0], POLLIN, 2, &rev);
+  if (r != 0 || rev != 0) {
+    printf("[ERROR] poll %d revents %x, expected 0 0\n", r, rev);
+    goto failed;
+  }
+  if (uptime() - t0 < 1) {
+    printf("[ERROR] poll timed out too soon\n");
+    goto failed;
+  }
+  printf("[SUCCESS] test 4 passed\n");
+  success++;
+failed:
+  close(fds[0]);
+  close(fds[1]);
+  printf("test 4 finished\n");
+}
+
+void test5() {
+  printf("test 5 started\n");
+  int fds[2], rev;
+  pipe(fds);
+  int child_proc = fork();
+  if (child_proc == 0) {
+    sleep(2);
+    write(fds[1], "x", 1);
+    exit(0);
+  }
+  int r = poll1(fds[0], POLLIN, -1, &rev);
+  wait(0);
+  if (r != 1 || rev != POLLIN) {
+    printf("[ERROR] poll %d revents %x, expected 1 %x\n", r, rev, POLLIN);
+    goto failed;
+  }
+  printf("[SUCCESS] test 5 passed\n");
+  success++;
+failed:
+  close(fds[0]);
+  close(fds[1]);
+  printf("test 5 finished\n");
+}
@@ -0,0 +1,349 @@
+// prof: where a program spends its time.
+//
+// runs prog with its arguments, sampling its pc on each
+// timer tick with sampleattach(), and when it exits prints
+// a flat profile: the samples that fell in each function,
+// named from prog.sym, the symbol table the Makefile writes
+// next to each program. name the .sym files to install in
+// SYMS when making fs.img, e.g. make SYMS=user/psum.sym.
+// without one, prof lists the sampled pcs themselves.
+// samples taken while prog was in the kernel are counted
+// apart, against the pc of its system call.
+//
+// with -k, profiles the kernel instead while prog runs,
+// with kprof(): each hart's timer ticks in the kernel,
+// whatever the process, by function, both where the tick
+// fell and counting the callers in its backtrace too.
+// functions are named from kernel.sym, which
+// make SYMS=user/kernel.sym installs.
+//
+//   prof [-k] prog [args...]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/poll.h"
+#include "kernel/sample.h"
+#include "kernel/kprof.h"
+#include "user/user.h"
+
+#define MAXPC 256
+#define NKREAD 64
+
+struct sym {
+  uint64 addr;
+  char *name;
+};
+
+struct sym *syms;
+int nsym;
+
+uint64 pcs[MAXPC];     // without symbols: distinct pcs seen
+int npc;
+int *counts;           // samples per symbol or pc
+int *tcounts;          // -k: samples with the symbol in the backtrace
+int nuser, nkernel, nlost;
+struct kpsample ks[NKREAD];
+
+static uint64
+hex(char *s, char **end)
+{
+  uint64 v = 0;
+
+  for(;; s++){
+    if(*s >= '0' && *s <= '9')
+      v = v*16 + *s - '0';
+    else if(*s >= 'a' && *s <= 'f')
+      v = v*16 + *s - 'a' + 10;
+    else
+      break;
+  }
+  *end = s;
+  return v;
+}
+
+// Read a symbol table written by the Makefile: lines of
+// an address in hex and a name. Keeps the symbols that are
+// C identifiers, dropping section and file names, sorted
+// by address.
+// Returns the number of symbols, or -1.
+int
+loadsyms(char *file, struct sym **psyms)
+{
+  struct stat st;
+  struct sym *s, t;
+  char *buf, *p, *q;
+  int fd, n, i, j;
+
+  if((fd = open(file, O_RDONLY)) < 0)
+    return -1;
+  if(fstat(fd, &st) < 0 || (buf = malloc(st.size + 1)) == 0){
+    close(fd);
+    return -1;
+  }
+  n = read(fd, buf, st.size);
+  close(fd);
+  if(n < 0)
+    return -1;
+  buf[n] = 0;
+
+  for(i = 0, p = buf; *p; p++)
+    if(*p == '\n')
+      i++;
+  if((s = malloc((i + 1) * sizeof(*s))) == 0)
+    return -1;
+
+  n = 0;
+  for(p = buf; *p; p = q){
+    for(q = p; *q && *q != '\n'; q++)
+      ;
+    if(*q)
+      *q++ = 0;
+    s[n].addr = hex(p, &p);
+    if(*p++ != ' ' || *p == 0 || strchr(p, '.'))
+      continue;
+    s[n].name = p;
+    // insert in address order.
+    for(j = n; j > 0 && s[j-1].addr > s[n].addr; j--)
+      ;
+    t = s[n];
+    for(i = n; i > j; i--)
+      s[i] = s[i-1];
+    s[j] = t;
+    n++;
+  }
+  *psyms = s;
+  return n;
+}
+
+// The index of the symbol containing addr, or -1.
+int
+findsym(struct sym *s, int n, uint64 addr)
+{
+  int lo = 0, hi = n;
+
+  // find the last symbol at or below addr.
+  while(lo < hi){
+    int mid = (lo + hi) / 2;
+    if(s[mid].addr <= addr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo - 1;
+}
+
+// Print the count[i] of each of n entries, busiest first,
+// named by name(i), as a percentage of total.
+void
+report(int *count, int n, int total, char *(*name)(int))
+{
+  int i, best;
+
+  if(total == 0)
+    total = 1;
+  for(;;){
+    best = -1;
+    for(i = 0; i < n; i++)
+      if(count[i] > 0 && (best < 0 || count[i] > count[best]))
+        best = i;
+    if(best < 0)
+      break;
+    printf("%d\t%d%%\t%s\n", count[best], count[best] * 100 / total, name(best));
+    count[best] = 0;
+  }
+}
+
+static char*
+symname(int i)
+{
+  return syms[i].name;
+}
+
+static char*
+pcname(int i)
+{
+  static char buf[20];
+  char *p = buf + sizeof(buf) - 1;
+  uint64 v = pcs[i];
+
+  *p = 0;
+  do {
+    *--p = "0123456789abcdef"[v % 16];
+    v /= 16;
+  } while(v);
+  *--p = 'x';
+  *--p = '0';
+  return p;
+}
+
+// count a sample at pc against its symbol, or the pc
+// itself without symbols.
+static void
+count(uint64 pc)
+{
+  int i;
+
+  if(nsym > 0){
+    if((i = findsym(syms, nsym, pc)) >= 0)
+      counts[i]++;
+    return;
+  }
+  for(i = 0; i < npc && pcs[i] != pc; i++)
+    ;
+  if(i == npc && npc < MAXPC)
+    pcs[npc++] = pc;
+  if(i < MAXPC)
+    counts[i]++;
+}
+
+// take the samples that have arrived in r.
+static void
+drain(struct samplering *r)
+{
+  uint head = r->head;
+  struct sample *s;
+
+  __sync_synchronize();
+  for(; r->tail != head; r->tail++){
+    s = &r->s[r->tail % NSAMPLE];
+    if(s->kernel){
+      nkernel++;
+      continue;
+    }
+    nuser++;
+    count(s->pc);
+  }
+}
+
+// take the kernel profiler's samples so far.
+static void
+kdrain(void)
+{
+  int n, i, j, k, sym[KPDEPTH];
+
+  while((n = kprof(KPROF_READ, ks, NKREAD)) > 0){
+    for(i = 0; i < n; i++){
+      count(ks[i].pc[0]);
+      if(nsym == 0)
+        continue;
+      // each function in the backtrace, once.
+      for(j = 0; j < KPDEPTH && ks[i].pc[j]; j++){
+        sym[j] = findsym(syms, nsym, ks[i].pc[j]);
+        for(k = 0; k < j && sym[k] != sym[j]; k++)
+          ;
+        if(k == j && sym[j] >= 0)
+          tcounts[sym[j]]++;
+      }
+    }
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct samplering *r = 0;
+  struct kprofstat st;
+  struct pollfd pfd;
+  int go[2], done[2], pid, kflag = 0, n, total;
+  char symfile[64], *base, *p;
+
+  if(argc > 1 && strcmp(argv[1], "-k") == 0){
+    kflag = 1;
+    argc--;
+    argv++;
+  }
+  if(argc < 2){
+    fprintf(2, "usage: prof [-k] prog [args...]\n");
+    exit(1);
+  }
+
+  for(base = p = argv[1]; *p; p++)
+    if(*p == '/')
+      base = p + 1;
+  if(kflag)
+    base = "kernel";
+  if(strlen(base) + 5 > sizeof(symfile)){
+    fprintf(2, "prof: name too long\n");
+    exit(1);
+  }
+  strcpy(symfile, base);
+  strcpy(symfile + strlen(base), ".sym");
+  if((nsym = loadsyms(symfile, &syms)) < 0)
+    nsym = 0;
+  n = nsym > MAXPC ? nsym : MAXPC;
+  if((counts = malloc(n * sizeof(int))) == 0 || (tcounts = malloc(n * sizeof(int))) == 0){
+    fprintf(2, "prof: out of memory\n");
+    exit(1);
+  }
+  memset(counts, 0, n * sizeof(int));
+  memset(tcounts, 0, n * sizeof(int));
+
+  // the child waits for go to close before exec, and holds
+  // done open until it exits.
+  pipe(go);
+  pipe(done);
+  if((pid = fork()) < 0){
+    fprintf(2, "prof: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    char c;
+    close(go[1]);
+    close(done[0]);
+    read(go[0], &c, 1);
+    close(go[0]);
+    exec(argv[1], argv + 1);
+    fprintf(2, "prof: exec %s failed\n", argv[1]);
+    exit(1);
+  }
+  close(go[0]);
+  close(done[1]);
+  if(kflag)
+    kprof(KPROF_START, 0, 0);
+  else if((r = sampleattach(pid, 0)) == (struct samplering*)-1){
+    fprintf(2, "prof: sampleattach failed\n");
+    kill(pid);
+    exit(1);
+  }
+  close(go[1]);
+
+  pfd.fd = done[0];
+  pfd.events = POLLIN;
+  for(;;){
+    poll(&pfd, 1, 1);
+    if(kflag)
+      kdrain();
+    else
+      drain(r);
+    if(pfd.revents)
+      break;
+  }
+  wait(0);
+
+  if(kflag){
+    kprof(KPROF_STOP, 0, 0);
+    kdrain();
+    kprof(KPROF_STAT, &st, 0);
+    printf("prof: kernel during %s: %d samples in the kernel, %d ticks in user space, %d lost\n",
+           argv[1], (int)st.kernel, (int)st.user, (int)st.dropped);
+    total = st.kernel - st.dropped;
+  } else {
+    drain(r);
+    nlost = r->dropped;
+    sampledetach();
+    printf("prof: %s: %d samples in user space, %d in the kernel, %d lost\n",
+           argv[1], nuser, nkernel, nlost);
+    total = nuser;
+  }
+  if(nsym == 0){
+    report(counts, npc, total, pcname);
+    exit(0);
+  }
+  report(counts, nsym, total, symname);
+  if(kflag){
+    printf("prof: including callers:\n");
+    report(tcounts, nsym, total, symname);
+  }
+  exit(0);
+}
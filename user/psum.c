@@ -0,0 +1,89 @@
+// psum: parallel sum over shared memory.
+//
+// fills an array of n ints, then for 1, 2, 4, ... up to
+// maxthreads threads has each thread sum its own slice
+// of it passes times, with the slices' totals collected
+// in a shared array. reports the time each run took and
+// its speedup over one thread. run with CPUS=4 or so.
+//
+//   psum [maxthreads [n [passes]]]
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "user/user.h"
+
+int *a;
+int n = 1<<20, passes = 50, nthreads;
+uint64 part[NTHREAD];
+
+void
+worker(void *arg)
+{
+  int id = (int)(uint64)arg;
+  int lo = (uint64)n * id / nthreads, hi = (uint64)n * (id+1) / nthreads;
+  uint64 s;
+
+  for(int k = 0; k < passes; k++){
+    s = 0;
+    for(int i = lo; i < hi; i++)
+      s += a[i];
+    part[id] = s;
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int maxthreads = 4, i, t0, t, t1thread = 0;
+  uint64 sum, want;
+
+  if(argc > 1)
+    maxthreads = atoi(argv[1]);
+  if(argc > 2)
+    n = atoi(argv[2]);
+  if(argc > 3)
+    passes = atoi(argv[3]);
+  if(maxthreads < 1)
+    maxthreads = 1;
+  if(maxthreads > NTHREAD-1)
+    maxthreads = NTHREAD-1;
+
+  if((a = (int*)sbrk(n * sizeof(int))) == (int*)-1){
+    fprintf(2, "psum: out of memory\n");
+    exit(1);
+  }
+  want = 0;
+  for(i = 0; i < n; i++){
+    a[i] = i % 1000;
+    want += a[i];
+  }
+
+  for(nthreads = 1; nthreads <= maxthreads; nthreads *= 2){
+    t0 = uptime();
+    for(i = 0; i < nthreads; i++){
+      if(thread_create(worker, (void*)(uint64)i) < 0){
+        fprintf(2, "psum: thread_create failed\n");
+        exit(1);
+      }
+    }
+    for(i = 0; i < nthreads; i++)
+      thread_join(0);
+    t = uptime() - t0;
+
+    sum = 0;
+    for(i = 0; i < nthreads; i++)
+      sum += part[i];
+    if(sum != want){
+      fprintf(2, "psum: %d threads: sum %l, want %l\n", nthreads, sum, want);
+      exit(1);
+    }
+    if(nthreads == 1)
+      t1thread = t;
+    if(t > 0)
+      printf("psum: %d threads: %d ticks, speedup %d.%dx\n", nthreads, t,
+             t1thread / t, (t1thread * 10 / t) % 10);
+    else
+      printf("psum: %d threads: %d ticks\n", nthreads, t);
+  }
+  exit(0);
+}
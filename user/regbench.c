@@ -0,0 +1,89 @@
+// regbench: sample children's registers.
+//
+// starts nchild children, then samples s2-s11 of every
+// child rounds times, first with a dump2() call per
+// register, then with one regsnap() call for them all,
+// and reports the system calls and time each took. the
+// two must agree, since the children are blocked in read().
+//
+//   regbench [nchild [rounds]]
+
+#include "kernel/types.h"
+#include "kernel/regset.h"
+#include "user/user.h"
+
+int nchild = 8, rounds = 100;
+int pids[NREGSET];
+struct regset rs[NREGSET];
+uint64 vals[NREGSET][10];
+
+int
+main(int argc, char *argv[])
+{
+  uint64 t0, v;
+  int p[2], i, r, k, calls;
+  char c;
+
+  if(argc > 1)
+    nchild = atoi(argv[1]);
+  if(argc > 2)
+    rounds = atoi(argv[2]);
+  if(nchild < 1 || nchild > NREGSET)
+    nchild = NREGSET;
+
+  pipe(p);
+  for(i = 0; i < nchild; i++){
+    if((pids[i] = fork()) < 0){
+      fprintf(2, "regbench: fork failed\n");
+      exit(1);
+    }
+    if(pids[i] == 0){
+      close(p[1]);
+      read(p[0], &c, 1);
+      exit(0);
+    }
+  }
+  close(p[0]);
+  sleep(1);
+
+  calls = 0;
+  t0 = vdso_clock();
+  for(k = 0; k < rounds; k++){
+    for(i = 0; i < nchild; i++){
+      for(r = 2; r <= 11; r++){
+        if(dump2(pids[i], r, &v) != 0){
+          fprintf(2, "regbench: dump2 failed\n");
+          exit(1);
+        }
+        vals[i][r-2] = v;
+        calls++;
+      }
+    }
+  }
+  printf("regbench: dump2: %d calls, %l us\n", calls, (vdso_clock() - t0) / 1000);
+
+  calls = 0;
+  t0 = vdso_clock();
+  for(k = 0; k < rounds; k++){
+    if(regsnap(pids, nchild, REGMASK_S, rs) != nchild){
+      fprintf(2, "regbench: regsnap failed\n");
+      exit(1);
+    }
+    calls++;
+  }
+  printf("regbench: regsnap: %d calls, %l us\n", calls, (vdso_clock() - t0) / 1000);
+
+  for(i = 0; i < nchild; i++){
+    for(r = 2; r <= 11; r++){
+      if(rs[i].err != 0 || rs[i].x[REG_S(r)] != vals[i][r-2]){
+        fprintf(2, "regbench: pid %d s%d differs\n", pids[i], r);
+        exit(1);
+      }
+    }
+  }
+
+  close(p[1]);
+  for(i = 0; i < nchild; i++)
+    wait(0);
+  exit(0);
+}
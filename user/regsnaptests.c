@@ -0,0 +1,180 @@
+#include "kernel/types.h"
+#include "kernel/regset.h"
+#include "user/user.h"
+
+int success;
+
+void test1();
+void test2();
+void test3();
+void test4();
+
+int main(void) {
+  printf("regsnap tests started\n");
+  success = 0;
+  test1();
+  test2();
+  test3();
+  test4();
+  printf("4 tests were run. %d tests passed\n", success);
+  exit(0);
+}
+
+int regsnap_test_asm(int pipefd, char *str, int len);
+
+struct regset rs[NREGSET + 5];
+int pids[NREGSET + 5];
+
+// start a child that sets s2-s11 to 102-111, then spins;
+// returns its pid once the registers are set.
+int start_child() {
+  int pipefd[2];
+  uint64 a;
+  pipe(pipefd);
+  int child_proc = fork();
+  if (child_proc == 0) {
+    a = 34381;
+    regsnap_test_asm(pipefd[1], (char *)(&a), 8);
+  }
+  read(pipefd[0], &a, 8);
+  close(pipefd[0]);
+  close(pipefd[1]);
+  return child_proc;
+}
+
+void stop_child(int child_proc) {
+  if (child_proc > 0) {
+    kill(child_proc);
+    wait(0);
+  }
+}
+
+void test1() {
+  printf("test 1 started\n");
+  int child_proc = start_child();
+  pids[0] = child_proc;
+  int n = regsnap(pids, 1, REGMASK_S, rs);
+  if (n != 1) {
+    printf("[ERROR] regsnap returned %d, expected 1\n", n);
+    goto failed;
+  }
+  if (rs[0].pid != child_proc || rs[0].err != 0) {
+    printf("[ERROR] pid %d err %d, expected pid %d err 0\n",
+           rs[0].pid, rs[0].err, child_proc);
+    goto failed;
+  }
+  for (int i = 2; i < 12; i++) {
+    if (rs[0].x[REG_S(i)] != 100 + i) {
+      printf("[ERROR] s%d expected: %d, found: %d\n", i, 100 + i,
+             (int)rs[0].x[REG_S(i)]);
+      goto failed;
+    }
+  }
+  printf("[SUCCESS] test 1 passed\n");
+  success++;
+failed:
+  stop_child(child_proc);
+  printf("test 1 finished\n");
+}
+
+void test2() {
+  printf("test 2 started\n");
+  int child_proc = start_child();
+  pids[0] = child_proc;
+  uint64 mask = (1L << REG_S(3)) | (1L << REG_PC);
+  if (regsnap(pids, 1, mask, rs) != 1 || rs[0].err != 0) {
+    printf("[ERROR] regsnap failed\n");
+    goto failed;
+  }
+  for (int i = 0; i < 32; i++) {
+    if ((mask & (1L << i)) == 0 && rs[0].x[i] != 0) {
+      printf("[ERROR] register %d not in the mask but is %p\n", i,
+             rs[0].x[i]);
+      goto failed;
+    }
+  }
+  if (rs[0].x[REG_S(3)] != 103) {
+    printf("[ERROR] s3 expected: 103, found: %d\n", (int)rs[0].x[REG_S(3)]);
+    goto failed;
+  }
+  if (rs[0].x[REG_PC] == 0) {
+    printf("[ERROR] pc was selected but is 0\n");
+    goto failed;
+  }
+  printf("[SUCCESS] test 2 passed\n");
+  success++;
+failed:
+  stop_child(child_proc);
+  printf("test 2 finished\n");
+}
+
+void test3() {
+  printf("test 3 started\n");
+  int pipefd[2], err[2];
+  pipe(pipefd);
+  int parent_pid = getpid();
+  printf("[INFO] testing nonexisting proccess\n");
+  pids[0] = 2147483647;
+  pids[1] = parent_pid;
+  if (regsnap(pids, 2, REGMASK_S, rs) != 2) {
+    printf("[ERROR] regsnap failed\n");
+    goto failed;
+  }
+  if (rs[0].err != -1 || rs[1].err != 0) {
+    printf("[ERROR] err %d and %d, expected -1 and 0\n", rs[0].err, rs[1].err);
+    goto failed;
+  }
+  printf("[OK] nonexisting proccess\n");
+  printf("[INFO] testing illegal access to registers\n");
+  int child_proc = fork();
+  if (child_proc == 0) {
+    pids[0] = parent_pid;
+    pids[1] = getpid();
+    regsnap(pids, 2, REGMASK_S, rs);
+    err[0] = rs[0].err;
+    err[1] = rs[1].err;
+    write(pipefd[1], err, sizeof(err));
+    exit(0);
+  }
+  read(pipefd[0], err, sizeof(err));
+  wait(0);
+  if (err[0] != -2 || err[1] != 0) {
+    printf("[ERROR] err %d and %d, expected -2 and 0\n", err[0], err[1]);
+    goto failed;
+  }
+  printf("[OK] illegal access to registers\n");
+  printf("[SUCCESS] test 3 passed\n");
+  success++;
+failed:
+  close(pipefd[0]);
+  close(pipefd[1]);
+  printf("test 3 finished\n");
+}
+
+void test4() {
+  printf("test 4 started\n");
+  for (int i = 0; i < NREGSET + 5; i++) {
+    pids[i] = getpid();
+    rs[i].err = 99;
+  }
+  int n = regsnap(pids, NREGSET + 5, REGMASK_S, rs);
+  if (n != NREGSET) {
+    printf("[ERROR] regsnap returned %d, expected %d\n", n, NREGSET);
+    goto failed;
+  }
+  for (int i = 0; i < NREGSET + 5; i++) {
+    if (rs[i].err != (i < NREGSET ? 0 : 99)) {
+      printf("[ERROR] regset %d has err %d\n", i, rs[i].err);
+      goto failed;
+    }
+  }
+  n = regsnap(pids, -1, REGMASK_S, rs);
+  if (n != -1) {
+    printf("[ERROR] regsnap of -1 pids returned %d, expected -1\n", n);
+    goto failed;
+  }
+  printf("[SUCCESS] test 4 passed\n");
+  success++;
+failed:
+  printf("test 4 finished\n");
+}
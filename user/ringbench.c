@@ -0,0 +1,173 @@
+// ringbench: cat through the submission ring.
+//
+// writes a kb-kilobyte file, then copies it chunk bytes
+// at a time, as cat does, twice: with a read() and a
+// write() system call per chunk, then through the ring
+// from ringsetup(), queueing the reads of up to batch
+// chunks and then their writes, with one ringenter()
+// for each. reports the time and system calls each took.
+//
+//   ringbench [kb [chunk [batch]]]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "kernel/ring.h"
+#include "user/user.h"
+
+#define IN "ringbench.in"
+#define OUT "ringbench.out"
+#define MAXCHUNK 4096
+
+int kb = 64, chunk = 64, batch = 32;
+char *bufs;
+struct ring *r;
+
+static int
+openfile(char *name, int omode)
+{
+  int fd;
+
+  if((fd = open(name, omode)) < 0){
+    fprintf(2, "ringbench: cannot open %s\n", name);
+    exit(1);
+  }
+  return fd;
+}
+
+static void
+submit(int op, int fd, char *buf, int n, uint64 data)
+{
+  struct sqe *e = &r->sq[r->sqtail % NRING];
+
+  e->op = op;
+  e->fd = fd;
+  e->addr = (uint64)buf;
+  e->n = n;
+  e->data = data;
+  __sync_synchronize();
+  r->sqtail++;
+}
+
+// have the kernel do the n queued operations, and
+// collect their results, in order, in res.
+static void
+enter(int n, int *res)
+{
+  if(ringenter(n) != n){
+    fprintf(2, "ringbench: ringenter failed\n");
+    exit(1);
+  }
+  __sync_synchronize();
+  for(int i = 0; i < n; i++){
+    struct cqe *c = &r->cq[r->cqhead % NRING];
+    res[c->data] = c->res;
+    r->cqhead++;
+  }
+}
+
+// copy with read() and write(); returns the system calls made.
+static int
+plain(int in, int out)
+{
+  int n, calls = 0;
+
+  for(;;){
+    n = read(in, bufs, chunk);
+    calls++;
+    if(n <= 0)
+      break;
+    if(write(out, bufs, n) != n){
+      fprintf(2, "ringbench: write error\n");
+      exit(1);
+    }
+    calls++;
+  }
+  return calls;
+}
+
+// copy through the ring; returns the system calls made.
+static int
+ring(int in, int out)
+{
+  int res[NRING], got[NRING];
+  int i, k, calls = 0, eof = 0;
+
+  while(!eof){
+    for(i = 0; i < batch; i++)
+      submit(RING_READ, in, bufs + i*chunk, chunk, i);
+    enter(batch, got);
+    calls++;
+    for(k = 0; k < batch && got[k] > 0; k++)
+      submit(RING_WRITE, out, bufs + k*chunk, got[k], k);
+    eof = k < batch;
+    if(k == 0)
+      break;
+    enter(k, res);
+    calls++;
+    for(i = 0; i < k; i++){
+      if(res[i] != got[i]){
+        fprintf(2, "ringbench: write error\n");
+        exit(1);
+      }
+    }
+  }
+  return calls;
+}
+
+// copy IN to OUT one way or the other, and report.
+static void
+run(char *name, int usering)
+{
+  struct stat st;
+  uint64 t0, t1;
+  int in, out, calls;
+
+  in = openfile(IN, O_RDONLY);
+  out = openfile(OUT, O_CREATE | O_TRUNC | O_WRONLY);
+  t0 = vdso_clock();
+  calls = usering ? ring(in, out) : plain(in, out);
+  t1 = vdso_clock();
+  if(fstat(out, &st) < 0 || st.size != kb * 1024){
+    fprintf(2, "ringbench: %s: copied %d bytes, want %d\n", name, (int)st.size, kb * 1024);
+    exit(1);
+  }
+  close(in);
+  close(out);
+  printf("ringbench: %s: %l us, %d system calls\n", name, (t1 - t0) / 1000, calls);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fd, i;
+
+  if(argc > 1)
+    kb = atoi(argv[1]);
+  if(argc > 2)
+    chunk = atoi(argv[2]);
+  if(argc > 3)
+    batch = atoi(argv[3]);
+  if(chunk < 1 || chunk > MAXCHUNK)
+    chunk = 64;
+  if(batch < 1 || batch > NRING)
+    batch = NRING;
+
+  if((bufs = malloc(batch * chunk)) == 0 || (r = ringsetup()) == (struct ring*)-1){
+    fprintf(2, "ringbench: setup failed\n");
+    exit(1);
+  }
+
+  fd = openfile(IN, O_CREATE | O_TRUNC | O_WRONLY);
+  memset(bufs, 'x', chunk);
+  for(i = 0; i < kb * 1024; i += chunk)
+    write(fd, bufs, kb * 1024 - i < chunk ? kb * 1024 - i : chunk);
+  close(fd);
+
+  printf("ringbench: %d KB in %d-byte chunks, ring batches of %d\n", kb, chunk, batch);
+  run("read/write", 0);
+  run("ring", 1);
+  unlink(IN);
+  unlink(OUT);
+  exit(0);
+}
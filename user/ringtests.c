@@ -0,0 +1,180 @@
+#include "kernel/types.h"
+#include "kernel/fcntl.h"
+#include "kernel/ring.h"
+#include "user/user.h"
+
+int success;
+struct ring *r;
+
+void test1();
+void test2();
+void test3();
+void test4();
+void test5();
+
+int main(void) {
+  printf("ring tests started\n");
+  if ((r = ringsetup()) == (struct ring *)-1) {
+    printf("ringsetup failed. Stop testing\n");
+    exit(1);
+  }
+  success = 0;
+  test1();
+  test2();
+  test3();
+  test4();
+  test5();
+  unlink("ringtests.tmp");
+  printf("5 tests were run. %d tests passed\n", success);
+  exit(0);
+}
+
+char *name = "ringtests.tmp";
+int tfd = -1;
+
+void submit(int op, int fd, void *addr, int n, int omode, uint64 data) {
+  struct sqe *e = &r->sq[r->sqtail % NRING];
+  e->op = op;
+  e->fd = fd;
+  e->addr = (uint64)addr;
+  e->n = n;
+  e->omode = omode;
+  e->data = data;
+  __sync_synchronize();
+  r->sqtail++;
+}
+
+// do the one queued operation and return its result,
+// or -100 if it didn't complete as expected.
+int enter1(uint64 data) {
+  int n = ringenter(1);
+  if (n != 1) {
+    printf("[ERROR] ringenter returned %d, expected 1\n", n);
+    return -100;
+  }
+  __sync_synchronize();
+  struct cqe *c = &r->cq[r->cqhead % NRING];
+  r->cqhead++;
+  if (c->data != data) {
+    printf("[ERROR] completion data %d, expected %d\n", (int)c->data,
+           (int)data);
+    return -100;
+  }
+  return c->res;
+}
+
+void test1() {
+  printf("test 1 started\n");
+  submit(RING_OPEN, 0, name, 0, O_CREATE | O_RDWR, 1);
+  tfd = enter1(1);
+  if (tfd < 0) {
+    printf("[ERROR] open returned %d\n", tfd);
+    goto failed;
+  }
+  submit(RING_OPEN, 0, "nosuchfile", 0, O_RDONLY, 2);
+  int res = enter1(2);
+  if (res != -1) {
+    printf("[ERROR] open of a missing file returned %d\n", res);
+    goto failed;
+  }
+  printf("[SUCCESS] test 1 passed\n");
+  success++;
+failed:
+  printf("test 1 finished\n");
+}
+
+void test2() {
+  printf("test 2 started\n");
+  submit(RING_WRITE, tfd, "hello", 5, 0, 3);
+  int res = enter1(3);
+  if (res != 5) {
+    printf("[ERROR] write returned %d, expected 5\n", res);
+    goto failed;
+  }
+  submit(RING_WRITE, 99, "hello", 5, 0, 4);
+  res = enter1(4);
+  if (res != -1) {
+    printf("[ERROR] write to a bad fd returned %d, expected -1\n", res);
+    goto failed;
+  }
+  printf("[SUCCESS] test 2 passed\n");
+  success++;
+failed:
+  printf("test 2 finished\n");
+}
+
+void test3() {
+  printf("test 3 started\n");
+  submit(RING_CLOSE, tfd, 0, 0, 0, 5);
+  int res = enter1(5);
+  if (res != 0) {
+    printf("[ERROR] close returned %d, expected 0\n", res);
+    goto failed;
+  }
+  submit(RING_CLOSE, tfd, 0, 0, 0, 6);
+  res = enter1(6);
+  if (res != -1) {
+    printf("[ERROR] second close returned %d, expected -1\n", res);
+    goto failed;
+  }
+  printf("[SUCCESS] test 3 passed\n");
+  success++;
+failed:
+  printf("test 3 finished\n");
+}
+
+void test4() {
+  printf("test 4 started\n");
+  char buf[8];
+  memset(buf, 0, sizeof(buf));
+  int rfd = open(name, O_RDONLY);
+  if (rfd < 0) {
+    printf("[ERROR] cannot open %s\n", name);
+    goto failed;
+  }
+  submit(RING_READ, rfd, buf, sizeof(buf), 0, 7);
+  int res = enter1(7);
+  close(rfd);
+  if (res != 5 || strcmp(buf, "hello") != 0) {
+    printf("[ERROR] read returned %d, \"%s\", expected 5, \"hello\"\n", res,
+           buf);
+    goto failed;
+  }
+  printf("[SUCCESS] test 4 passed\n");
+  success++;
+failed:
+  printf("test 4 finished\n");
+}
+
+void test5() {
+  printf("test 5 started\n");
+  int n = ringenter(NRING);
+  if (n != 0) {
+    printf("[ERROR] ringenter with nothing queued returned %d\n", n);
+    goto failed;
+  }
+  // several in one call complete in order.
+  submit(RING_OPEN, 0, name, 0, O_RDONLY, 10);
+  submit(RING_OPEN, 0, name, 0, O_RDONLY, 11);
+  submit(RING_OPEN, 0, name, 0, O_RDONLY, 12);
+  n = ringenter(NRING);
+  if (n != 3) {
+    printf("[ERROR] ringenter returned %d, expected 3\n", n);
+    goto failed;
+  }
+  __sync_synchronize();
+  for (int i = 0; i < 3; i++) {
+    struct cqe *c = &r->cq[r->cqhead % NRING];
+    r->cqhead++;
+    if (c->data != 10 + i || c->res < 0) {
+      printf("[ERROR] completion %d: data %d res %d\n", i, (int)c->data,
+             c->res);
+      goto failed;
+    }
+    close(c->res);
+  }
+  printf("[SUCCESS] test 5 passed\n");
+  success++;
+failed:
+  printf("test 5 finished\n");
+}
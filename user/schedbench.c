@@ -0,0 +1,90 @@
+// schedbench: interactive latency under CPU load.
+//
+// starts nhogs CPU-bound children, then bounces a byte
+// between two processes over a pair of pipes, the way a
+// shell waits for a keystroke and answers it. reports how
+// long the round trips took in total and the worst one,
+// in ticks. hognice, if given, is the hogs' nice value.
+//
+//   schedbench [nhogs [rounds [hognice]]]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+#define MAXHOGS 32
+
+int
+main(int argc, char *argv[])
+{
+  int nhogs = 4, rounds = 100, hognice = 0;
+  int hogs[MAXHOGS], p1[2], p2[2], i, pid, t0, t1, worst, total;
+  char c = 'x';
+
+  if(argc > 1)
+    nhogs = atoi(argv[1]);
+  if(argc > 2)
+    rounds = atoi(argv[2]);
+  if(argc > 3)
+    hognice = argv[3][0] == '-' ? -atoi(argv[3]+1) : atoi(argv[3]);
+  if(nhogs > MAXHOGS)
+    nhogs = MAXHOGS;
+
+  for(i = 0; i < nhogs; i++){
+    if((hogs[i] = fork()) < 0){
+      fprintf(2, "schedbench: fork failed\n");
+      exit(1);
+    }
+    if(hogs[i] == 0){
+      volatile uint64 n = 0;
+      setpriority(0, hognice);
+      for(;;)
+        n++;
+    }
+  }
+
+  if(pipe(p1) < 0 || pipe(p2) < 0){
+    fprintf(2, "schedbench: pipe failed\n");
+    exit(1);
+  }
+  if((pid = fork()) < 0){
+    fprintf(2, "schedbench: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    // the interactive peer: answer each request.
+    close(p1[1]);
+    close(p2[0]);
+    while(read(p1[0], &c, 1) == 1)
+      write(p2[1], &c, 1);
+    exit(0);
+  }
+  close(p1[0]);
+  close(p2[1]);
+
+  worst = total = 0;
+  for(i = 0; i < rounds; i++){
+    // think for a moment between requests, like a user typing.
+    sleep(1);
+    t0 = uptime();
+    if(write(p1[1], &c, 1) != 1 || read(p2[0], &c, 1) != 1){
+      fprintf(2, "schedbench: ping-pong failed\n");
+      exit(1);
+    }
+    t1 = uptime();
+    total += t1 - t0;
+    if(t1 - t0 > worst)
+      worst = t1 - t0;
+  }
+  close(p1[1]);
+  wait(0);
+
+  for(i = 0; i < nhogs; i++)
+    kill(hogs[i]);
+  for(i = 0; i < nhogs; i++)
+    wait(0);
+
+  printf("schedbench: %d hogs (nice %d): %d round trips, %d ticks waiting, worst %d ticks\n",
+         nhogs, hognice, rounds, total, worst);
+  exit(0);
+}
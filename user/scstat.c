@@ -0,0 +1,95 @@
+// scstat: system call counts and latencies.
+//
+// lists each system call made since boot, or since the
+// last reset, with its count and total, average and
+// maximum time, and the 50th and 99th percentiles as the
+// upper bounds of their histogram buckets, all in ns.
+// -h also prints each call's log2 histogram, and -r resets
+// the statistics after printing them.
+//
+//   scstat [-h] [-r]
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/scstat.h"
+#include "user/user.h"
+
+#define MAXSYSCALL 64
+#define NS(t) ((t) * (1000000000 / TIMEBASE))
+
+struct scstat st[MAXSYSCALL];
+
+// the upper bound, in cycles, of the bucket holding the
+// frac-th fraction of s's calls.
+static uint64
+pct(struct scstat *s, int frac)
+{
+  uint64 n = 0, want = (s->count * frac + 99) / 100;
+  int i;
+
+  for(i = 0; i < NSCHIST - 1; i++){
+    n += s->hist[i];
+    if(n >= want)
+      break;
+  }
+  return i == NSCHIST - 1 ? s->max : 1L << i;
+}
+
+static void
+hist(struct scstat *s)
+{
+  uint64 most = 0;
+  int i, k;
+
+  for(i = 0; i < NSCHIST; i++)
+    if(s->hist[i] > most)
+      most = s->hist[i];
+  for(i = 0; i < NSCHIST; i++){
+    if(s->hist[i] == 0)
+      continue;
+    if(i == NSCHIST - 1)
+      printf("\t    more\t%l\t", s->hist[i]);
+    else
+      printf("\t< %l\t%l\t", NS(1L << i), s->hist[i]);
+    for(k = 0; k < (s->hist[i] * 40 + most - 1) / most; k++)
+      printf("*");
+    printf("\n");
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, n, hflag = 0, reset = 0;
+  struct scstat *s;
+
+  for(i = 1; i < argc; i++){
+    if(strcmp(argv[i], "-h") == 0)
+      hflag = 1;
+    else if(strcmp(argv[i], "-r") == 0)
+      reset = 1;
+    else {
+      fprintf(2, "usage: scstat [-h] [-r]\n");
+      exit(1);
+    }
+  }
+  if((n = scstat(st, MAXSYSCALL, reset)) < 0){
+    fprintf(2, "scstat: scstat failed\n");
+    exit(1);
+  }
+  if(n > MAXSYSCALL)
+    n = MAXSYSCALL;
+
+  printf("call\t\tcount\ttotal\tavg\tmax\tp50\tp99 (ns)\n");
+  for(i = 0; i < n; i++){
+    s = &st[i];
+    if(s->count == 0)
+      continue;
+    printf("%s\t%s%l\t%l\t%l\t%l\t%l\t%l\n", sysname(i), strlen(sysname(i)) < 8 ? "\t" : "",
+           s->count, NS(s->time), NS(s->time / s->count), NS(s->max),
+           NS(pct(s, 50)), NS(pct(s, 99)));
+    if(hflag)
+      hist(s);
+  }
+  exit(0);
+}
@@ -0,0 +1,43 @@
+// sleepbench: how long nanosleep() really sleeps.
+//
+// for a range of requested durations, from a microsecond
+// to a tick and beyond, sleeps iters times and reports the
+// average time actually slept, measured with clock_gettime(),
+// and how far past the deadline that was. before per-sleeper
+// timers every sleep rounded up to a whole tick.
+//
+//   sleepbench [iters]
+
+#include "kernel/types.h"
+#include "user/user.h"
+
+uint64 durations[] = { 1000, 10000, 100000, 1000000, 10000000, 100000000, 250000000 };
+
+int
+main(int argc, char *argv[])
+{
+  int iters = 10;
+  uint64 t0, t1, ns, avg;
+
+  if(argc > 1)
+    iters = atoi(argv[1]);
+  if(iters < 1)
+    iters = 1;
+
+  printf("sleepbench: requested(us) slept(us) late(us)\n");
+  for(int i = 0; i < sizeof(durations)/sizeof(durations[0]); i++){
+    ns = durations[i];
+    clock_gettime(&t0);
+    for(int k = 0; k < iters; k++){
+      if(nanosleep(ns) < 0){
+        fprintf(2, "sleepbench: nanosleep failed\n");
+        exit(1);
+      }
+    }
+    clock_gettime(&t1);
+    avg = (t1 - t0) / iters;
+    printf("sleepbench: %l %l %l\n", ns / 1000, avg / 1000,
+           avg > ns ? (avg - ns) / 1000 : 0);
+  }
+  exit(0);
+}
@@ -0,0 +1,126 @@
+// smallfilebench: many processes making small files at once.
+//
+// starts nproc processes that each create, write, read back
+// and delete nfiles small files in one shared directory, so
+// they contend for the directory's inode lock and the
+// buffer locks, which are sleep locks held only briefly.
+// runs twice, first with sleep locks sleeping as soon as
+// they find the lock held, then spinning while its holder
+// runs on another hart, and reports the time each took.
+// run it with CPUS=4 or more.
+//
+//   smallfilebench [nproc [nfiles]]
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/fcntl.h"
+#include "user/user.h"
+
+#define DIR "sfb"
+#define FILESIZE 100
+#define MAXPROC 26
+#define MAXFILES 100  // at once, leaving fs.img some inodes
+
+int nproc = 4, nfiles = 20;
+
+// DIR/ followed by the worker's letter and the file's number.
+static void
+name(char *buf, int w, int i)
+{
+  strcpy(buf, DIR "/");
+  buf[4] = 'a' + w;
+  buf[5] = '0' + i / 100 % 10;
+  buf[6] = '0' + i / 10 % 10;
+  buf[7] = '0' + i % 10;
+  buf[8] = 0;
+}
+
+static void
+worker(int w)
+{
+  char path[16], buf[FILESIZE];
+  int i, fd;
+
+  memset(buf, 'a' + w, sizeof(buf));
+  for(i = 0; i < nfiles; i++){
+    name(path, w, i);
+    if((fd = open(path, O_CREATE | O_WRONLY)) < 0 || write(fd, buf, sizeof(buf)) != sizeof(buf)){
+      fprintf(2, "smallfilebench: cannot write %s\n", path);
+      exit(1);
+    }
+    close(fd);
+  }
+  for(i = 0; i < nfiles; i++){
+    name(path, w, i);
+    if((fd = open(path, O_RDONLY)) < 0 || read(fd, buf, sizeof(buf)) != sizeof(buf)){
+      fprintf(2, "smallfilebench: cannot read %s\n", path);
+      exit(1);
+    }
+    close(fd);
+  }
+  for(i = 0; i < nfiles; i++){
+    name(path, w, i);
+    if(unlink(path) < 0){
+      fprintf(2, "smallfilebench: cannot unlink %s\n", path);
+      exit(1);
+    }
+  }
+  exit(0);
+}
+
+static void
+run(char *mode, int spin)
+{
+  uint64 t0, t1;
+  int i, xstate, failed = 0;
+
+  setsleepspin(spin);
+  t0 = vdso_clock();
+  for(i = 0; i < nproc; i++){
+    int pid = fork();
+    if(pid < 0){
+      fprintf(2, "smallfilebench: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0)
+      worker(i);
+  }
+  for(i = 0; i < nproc; i++){
+    wait(&xstate);
+    failed |= xstate;
+  }
+  t1 = vdso_clock();
+  if(failed){
+    fprintf(2, "smallfilebench: %s: a worker failed\n", mode);
+    exit(1);
+  }
+  printf("smallfilebench: %s: %l ms, %l us per file\n", mode,
+         (t1 - t0) / 1000000, (t1 - t0) / 1000 / (nproc * nfiles));
+}
+
+int
+main(int argc, char *argv[])
+{
+  int old;
+
+  if(argc > 1)
+    nproc = atoi(argv[1]);
+  if(argc > 2)
+    nfiles = atoi(argv[2]);
+  if(nproc < 1 || nproc > MAXPROC)
+    nproc = 4;
+  if(nfiles < 1 || nproc * nfiles > MAXFILES)
+    nfiles = MAXFILES / nproc;
+
+  if(mkdir(DIR) < 0){
+    fprintf(2, "smallfilebench: cannot make %s\n", DIR);
+    exit(1);
+  }
+  printf("smallfilebench: %d processes x %d files of %d bytes\n", nproc, nfiles, FILESIZE);
+  old = setsleepspin(0);
+  run("sleep", 0);
+  run("spin then sleep", 1);
+  setsleepspin(old);
+  unlink(DIR);
+  exit(0);
+}
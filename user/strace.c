@@ -0,0 +1,143 @@
+// strace: print the system calls a program makes.
+//
+// runs prog with its arguments with trace() on for every
+// system call, which its children inherit, and prints each
+// call as the kernel logs it to the trace device: the pid,
+// the call with its first three arguments as raw values,
+// and what it returned. calls that block may show up as
+// "resumed" if their return is drained first. the log goes
+// to standard error, apart from prog's output. events from
+// someone else's general system call tracing are skipped.
+//
+//   strace prog [args...]
+
+#include "kernel/types.h"
+#include "kernel/fcntl.h"
+#include "kernel/poll.h"
+#include "kernel/syscall.h"
+#include "kernel/trace.h"
+#include "user/user.h"
+
+#define NREAD 64
+#define NPENDING 64
+
+struct traceev ev[NREAD];
+struct traceev pending[NPENDING];  // calls not yet returned, by pid
+
+static struct traceev*
+lookup(int pid)
+{
+  struct traceev *free = 0;
+
+  for(int i = 0; i < NPENDING; i++){
+    if(pending[i].pid == pid)
+      return &pending[i];
+    if(pending[i].pid == 0 && free == 0)
+      free = &pending[i];
+  }
+  return free;
+}
+
+static void
+call(struct traceev *e)
+{
+  fprintf(2, "%d %s(%p, %p, %p)", e->pid, sysname(e->arg[0]),
+          e->arg[1], e->arg[2], e->arg[3]);
+}
+
+static void
+print(struct traceev *e)
+{
+  struct traceev *p;
+
+  switch(e->id){
+  case TR_LOST:
+    fprintf(2, "strace: %l events lost\n", e->arg[0]);
+    break;
+  case TR_SYSCALL | TR_STRACED:
+    if(e->arg[0] == SYS_exit || (p = lookup(e->pid)) == 0){
+      call(e);
+      fprintf(2, "\n");
+    } else {
+      if(p->pid != 0){
+        // its return was lost.
+        call(p);
+        fprintf(2, " = ?\n");
+      }
+      *p = *e;
+    }
+    break;
+  case TR_SYSRET | TR_STRACED:
+    if((p = lookup(e->pid)) != 0 && p->pid == e->pid){
+      call(p);
+      p->pid = 0;
+    } else {
+      fprintf(2, "%d %s resumed", e->pid, sysname(e->arg[0]));
+    }
+    fprintf(2, " = %d\n", (int)e->arg[1]);
+    break;
+  }
+}
+
+// read and print the calls logged so far.
+static void
+drain(int fd)
+{
+  struct traceev t;
+  int n, i, j;
+
+  while((n = read(fd, ev, sizeof(ev)) / sizeof(ev[0])) > 0){
+    for(i = 1; i < n; i++){
+      t = ev[i];
+      for(j = i; j > 0 && ev[j-1].time > t.time; j--)
+        ev[j] = ev[j-1];
+      ev[j] = t;
+    }
+    for(i = 0; i < n; i++)
+      print(&ev[i]);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct pollfd pfd;
+  int fd, done[2], pid;
+
+  if(argc < 2){
+    fprintf(2, "usage: strace prog [args...]\n");
+    exit(1);
+  }
+  if((fd = open("trace", O_RDONLY)) < 0){
+    fprintf(2, "strace: cannot open trace\n");
+    exit(1);
+  }
+
+  // the child holds done open until it exits.
+  pipe(done);
+  if((pid = fork()) < 0){
+    fprintf(2, "strace: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    close(done[0]);
+    close(fd);
+    trace(~0L);
+    exec(argv[1], argv + 1);
+    fprintf(2, "strace: exec %s failed\n", argv[1]);
+    exit(1);
+  }
+  close(done[1]);
+
+  pfd.fd = done[0];
+  pfd.events = POLLIN;
+  for(;;){
+    poll(&pfd, 1, 1);
+    drain(fd);
+    if(pfd.revents)
+      break;
+  }
+  wait(0);
+  drain(fd);
+  exit(0);
+}
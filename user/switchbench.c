@@ -0,0 +1,116 @@
+// switchbench: context-switch latency.
+//
+// bounces a byte between two processes over a pair of
+// pipes, so every round trip is two blocking reads and
+// two switches, and reports the time per switch. run it
+// with CPUS=1 to keep both processes on one hart, where
+// each switch is one process handing the CPU to the other.
+//
+// the ping-pong runs twice, first with the wakeup handoff
+// off and then on, alongside nhogs CPU-bound processes that
+// compete with the woken peer for the CPU.
+//
+//   switchbench [rounds [nhogs]]
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+// a tick is TICKCYCLES cycles of qemu's 10MHz timebase.
+#define TICKUS (TICKCYCLES / 10)
+
+#define MAXHOGS 32
+
+// returns the number of ticks rounds round trips took.
+static int
+pingpong(int rounds)
+{
+  int p1[2], p2[2], i, pid, t0, t1;
+  char c = 'x';
+
+  if(pipe(p1) < 0 || pipe(p2) < 0){
+    fprintf(2, "switchbench: pipe failed\n");
+    exit(1);
+  }
+  if((pid = fork()) < 0){
+    fprintf(2, "switchbench: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    close(p1[1]);
+    close(p2[0]);
+    while(read(p1[0], &c, 1) == 1)
+      write(p2[1], &c, 1);
+    exit(0);
+  }
+  close(p1[0]);
+  close(p2[1]);
+
+  t0 = uptime();
+  for(i = 0; i < rounds; i++){
+    if(write(p1[1], &c, 1) != 1 || read(p2[0], &c, 1) != 1){
+      fprintf(2, "switchbench: ping-pong failed\n");
+      exit(1);
+    }
+  }
+  t1 = uptime();
+  close(p1[1]);
+  close(p2[0]);
+  wait(0);
+  return t1 - t0;
+}
+
+static uint64
+report(char *what, int rounds, int t)
+{
+  uint64 us = (uint64)t * TICKUS;
+
+  printf("switchbench: handoff %s: %d round trips in %d ticks, %l us per round trip, %l us per switch\n",
+         what, rounds, t, us / rounds, us / (2 * rounds));
+  return us / rounds;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int rounds = 10000, nhogs = 0, hogs[MAXHOGS], i, old;
+  uint64 off, on;
+
+  if(argc > 1)
+    rounds = atoi(argv[1]);
+  if(argc > 2)
+    nhogs = atoi(argv[2]);
+  if(rounds < 1)
+    rounds = 1;
+  if(nhogs > MAXHOGS)
+    nhogs = MAXHOGS;
+
+  for(i = 0; i < nhogs; i++){
+    if((hogs[i] = fork()) < 0){
+      fprintf(2, "switchbench: fork failed\n");
+      exit(1);
+    }
+    if(hogs[i] == 0){
+      volatile uint64 n = 0;
+      for(;;)
+        n++;
+    }
+  }
+
+  old = sethandoff(0);
+  off = report("off", rounds, pingpong(rounds));
+  sethandoff(1);
+  on = report("on", rounds, pingpong(rounds));
+  sethandoff(old);
+
+  for(i = 0; i < nhogs; i++)
+    kill(hogs[i]);
+  for(i = 0; i < nhogs; i++)
+    wait(0);
+
+  if(off > 0)
+    printf("switchbench: %d hogs: handoff cuts round trip latency by %l%%\n",
+           nhogs, off > on ? (off - on) * 100 / off : 0);
+  exit(0);
+}
@@ -0,0 +1,30 @@
+// names of the system calls, for tools that report on them.
+
+#include "kernel/types.h"
+#include "kernel/syscall.h"
+#include "user/user.h"
+
+#define N(name) [SYS_##name] #name
+
+static char *names[] = {
+  N(fork), N(exit), N(wait), N(pipe), N(read), N(kill), N(exec),
+  N(fstat), N(chdir), N(dup), N(getpid), N(sbrk), N(sleep),
+  N(uptime), N(open), N(write), N(mknod), N(unlink), N(link),
+  N(mkdir), N(close), N(dump), N(dump2), N(setpriority),
+  N(getpriority), N(cpustat), N(sethandoff), N(clone), N(join),
+  N(sbrkshared), N(futex_wait), N(futex_wake),
+  N(sched_setaffinity), N(sched_getaffinity), N(procstat),
+  N(nanosleep), N(clock_gettime), N(ringsetup), N(ringenter),
+  N(poll), N(regsnap), N(sampleattach), N(sampledetach),
+  N(kprof), N(scstat), N(trace), N(lockstat),
+  N(lockbench), N(setsleepspin),
+};
+
+// The name of system call num, or "?".
+char*
+sysname(int num)
+{
+  if(num < 0 || num >= sizeof(names)/sizeof(names[0]) || names[num] == 0)
+    return "?";
+  return names[num];
+}
@@ -0,0 +1,192 @@
+// threads made with clone(): each shares the caller's
+// memory, open files and current directory, and runs on
+// its own stack from malloc().
+//
+// mutexes and condition variables built on futexes: taking
+// a free mutex or signalling with no waiters is just an
+// atomic instruction; only contended operations enter the
+// kernel, to sleep in futex_wait() or wake in futex_wake().
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "user/user.h"
+
+#define STACKSIZE (4*4096)
+
+// at the bottom of each thread's stack.
+struct tstart {
+  void (*fn)(void*);
+  void *arg;
+};
+
+// stacks of threads not yet joined; stack 0 means free.
+static struct {
+  int tid;
+  char *stack;
+} threads[NTHREAD];
+
+// guards threads[] and malloc(), which isn't thread-safe.
+static volatile int tlock;
+
+static void
+lock(void)
+{
+  while(__sync_lock_test_and_set(&tlock, 1) != 0)
+    ;
+  __sync_synchronize();
+}
+
+static void
+unlock(void)
+{
+  __sync_synchronize();
+  __sync_lock_release(&tlock);
+}
+
+static void
+threadstart(void *a)
+{
+  struct tstart *t = a;
+
+  t->fn(t->arg);
+  exit(0);
+}
+
+// Start a thread running fn(arg).
+// Returns its thread id, or -1.
+int
+thread_create(void (*fn)(void*), void *arg)
+{
+  struct tstart *t;
+  char *stack;
+  int i, tid;
+
+  lock();
+  for(i = 0; i < NTHREAD; i++)
+    if(threads[i].stack == 0)
+      break;
+  if(i == NTHREAD || (stack = malloc(STACKSIZE)) == 0){
+    unlock();
+    return -1;
+  }
+  t = (struct tstart*)stack;
+  t->fn = fn;
+  t->arg = arg;
+  // clone with tlock held, so that a thread_join() that
+  // catches the new thread's exit finds its slot.
+  if((tid = clone(threadstart, t, stack + STACKSIZE)) < 0){
+    free(stack);
+    unlock();
+    return -1;
+  }
+  threads[i].tid = tid;
+  threads[i].stack = stack;
+  unlock();
+  return tid;
+}
+
+// Wait for thread tid, or any thread if tid is 0, started
+// by this thread, to finish, and free its stack. Returns
+// the thread id, or -1 if there was no such thread.
+int
+thread_join(int tid)
+{
+  int i;
+
+  if((tid = join(tid, 0)) < 0)
+    return -1;
+  lock();
+  for(i = 0; i < NTHREAD; i++){
+    if(threads[i].stack && threads[i].tid == tid){
+      free(threads[i].stack);
+      threads[i].stack = 0;
+      break;
+    }
+  }
+  unlock();
+  return tid;
+}
+
+void
+mutex_init(struct mutex *m)
+{
+  m->state = 0;
+}
+
+int
+mutex_trylock(struct mutex *m)
+{
+  return __sync_bool_compare_and_swap(&m->state, 0, 1);
+}
+
+void
+mutex_lock(struct mutex *m)
+{
+  int c;
+
+  if((c = __sync_val_compare_and_swap(&m->state, 0, 1)) == 0)
+    return;
+  // mark it contended, so the holder wakes someone when it
+  // unlocks, and sleep until it does.
+  if(c != 2)
+    c = __sync_lock_test_and_set(&m->state, 2);
+  while(c != 0){
+    futex_wait(&m->state, 2, 0);
+    c = __sync_lock_test_and_set(&m->state, 2);
+  }
+}
+
+void
+mutex_unlock(struct mutex *m)
+{
+  if(__sync_fetch_and_sub(&m->state, 1) != 1){
+    // there may be waiters.
+    m->state = 0;
+    __sync_synchronize();
+    futex_wake(&m->state, 1);
+  }
+}
+
+void
+cond_init(struct cond *c)
+{
+  c->seq = 0;
+}
+
+// Wait for a signal for up to timeout ticks, or forever
+// if timeout is 0, with m released meanwhile.
+// Returns 1 if the timeout expired, 0 otherwise.
+int
+cond_timedwait(struct cond *c, struct mutex *m, int timeout)
+{
+  int seq = c->seq, r;
+
+  mutex_unlock(m);
+  // returns at once if there was a signal since we
+  // read seq.
+  r = futex_wait(&c->seq, seq, timeout);
+  // others may be waiting for m, so take it as contended.
+  while(__sync_lock_test_and_set(&m->state, 2) != 0)
+    futex_wait(&m->state, 2, 0);
+  return r == 1;
+}
+
+void
+cond_wait(struct cond *c, struct mutex *m)
+{
+  cond_timedwait(c, m, 0);
+}
+
+void
+cond_signal(struct cond *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake(&c->seq, 1);
+}
+
+void
+cond_broadcast(struct cond *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake(&c->seq, 0x7fffffff);
+}
@@ -0,0 +1,184 @@
+#include "kernel/types.h"
+#include "user/user.h"
+
+#define STACKSIZE (4*4096)
+
+int success;
+
+void test1();
+void test2();
+void test3();
+void test4();
+void test5();
+
+int main(void) {
+  printf("thread tests started\n");
+  success = 0;
+  test1();
+  test2();
+  test3();
+  test4();
+  test5();
+  printf("5 tests were run. %d tests passed\n", success);
+  exit(0);
+}
+
+// state the threads below share with the main thread.
+volatile int shared;
+int gate[2];
+
+// start fn(arg) in a thread on a fresh stack, which
+// is left to leak; returns the tid.
+int start(void (*fn)(void *), void *arg) {
+  char *stack = malloc(STACKSIZE);
+  if (stack == 0)
+    return -1;
+  return clone(fn, arg, stack + STACKSIZE);
+}
+
+void exit_with(void *arg) {
+  exit((int)(uint64)arg);
+}
+
+void test1() {
+  printf("test 1 started\n");
+  int status = -1;
+  int tid = start(exit_with, (void *)7);
+  if (tid <= 0) {
+    printf("[ERROR] clone returned %d\n", tid);
+    goto failed;
+  }
+  int r = join(tid, &status);
+  if (r != tid) {
+    printf("[ERROR] join returned %d, expected %d\n", r, tid);
+    goto failed;
+  }
+  if (status != 7) {
+    printf("[ERROR] exit status %d, expected 7\n", status);
+    goto failed;
+  }
+  r = join(tid, 0);
+  if (r != -1) {
+    printf("[ERROR] second join returned %d, expected -1\n", r);
+    goto failed;
+  }
+  printf("[SUCCESS] test 1 passed\n");
+  success++;
+failed:
+  printf("test 1 finished\n");
+}
+
+void store(void *arg) {
+  shared = 1234;
+  *(int *)arg = 5678;
+  exit(0);
+}
+
+void test2() {
+  printf("test 2 started\n");
+  int *heap = malloc(sizeof(int));
+  shared = 0;
+  *heap = 0;
+  int tid = start(store, heap);
+  if (tid <= 0 || join(tid, 0) != tid) {
+    printf("[ERROR] clone or join failed\n");
+    goto failed;
+  }
+  if (shared != 1234 || *heap != 5678) {
+    printf("[ERROR] thread's stores not seen: %d %d\n", shared, *heap);
+    goto failed;
+  }
+  printf("[SUCCESS] test 2 passed\n");
+  success++;
+failed:
+  free(heap);
+  printf("test 2 finished\n");
+}
+
+void closefd(void *arg) {
+  exit(close((int)(uint64)arg) == 0 ? 0 : 1);
+}
+
+void test3() {
+  printf("test 3 started\n");
+  int fds[2], status = -1;
+  char c;
+  pipe(fds);
+  int tid = start(closefd, (void *)(uint64)fds[0]);
+  if (tid <= 0 || join(tid, &status) != tid || status != 0) {
+    printf("[ERROR] thread could not close the fd\n");
+    goto failed;
+  }
+  if (read(fds[0], &c, 1) != -1) {
+    printf("[ERROR] fd closed by a thread is still open\n");
+    goto failed;
+  }
+  printf("[SUCCESS] test 3 passed\n");
+  success++;
+failed:
+  close(fds[0]);
+  close(fds[1]);
+  printf("test 3 finished\n");
+}
+
+// wait, alive, until the main thread writes to gate.
+void block(void *arg) {
+  char c;
+  read(gate[0], &c, 1);
+  exit(0);
+}
+
+void test4() {
+  printf("test 4 started\n");
+  pipe(gate);
+  if (sbrk(4096) == (char *)-1) {
+    printf("[ERROR] sbrk grow failed\n");
+    goto failed;
+  }
+  int tid = start(block, 0);
+  if (tid <= 0) {
+    printf("[ERROR] clone failed\n");
+    goto failed;
+  }
+  char *r = sbrk(-4096);
+  write(gate[1], "x", 1);
+  join(tid, 0);
+  if (r != (char *)-1) {
+    printf("[ERROR] sbrk shrink with a live thread succeeded\n");
+    goto failed;
+  }
+  if (sbrk(-4096) == (char *)-1) {
+    printf("[ERROR] sbrk shrink failed after the join\n");
+    goto failed;
+  }
+  printf("[SUCCESS] test 4 passed\n");
+  success++;
+failed:
+  close(gate[0]);
+  close(gate[1]);
+  printf("test 4 finished\n");
+}
+
+void test5() {
+  printf("test 5 started\n");
+  char *argv[] = { "echo", "[ERROR] exec succeeded", 0 };
+  pipe(gate);
+  int tid = start(block, 0);
+  if (tid <= 0) {
+    printf("[ERROR] clone failed\n");
+    goto failed;
+  }
+  int r = exec("echo", argv);
+  write(gate[1], "x", 1);
+  join(tid, 0);
+  if (r != -1) {
+    printf("[ERROR] exec returned %d, expected -1\n", r);
+    goto failed;
+  }
+  printf("[SUCCESS] test 5 passed\n");
+  success++;
+failed:
+  close(gate[0]);
+  close(gate[1]);
+  printf("test 5 finished\n");
+}
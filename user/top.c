@@ -0,0 +1,124 @@
+// top: list processes with their share of the CPU.
+//
+// samples every process's statistics, waits delay ticks,
+// samples again, and lists the processes busiest first:
+// %CPU over the interval, then totals since each started:
+// user and system time and time spent waiting for a hart,
+// in ticks, and voluntary and involuntary switches.
+//
+//   top [delay [iterations]]
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/procstat.h"
+#include "user/user.h"
+
+#define MAXPROCS 128
+
+struct procstat before[MAXPROCS], after[MAXPROCS];
+int pct[MAXPROCS], order[MAXPROCS];
+
+char *states[] = { "unused", "used", "sleep", "runble", "run", "zombie" };
+
+// print s left-justified in a field of width w.
+void
+col(char *s, int w)
+{
+  int n = strlen(s);
+
+  printf("%s", s);
+  for(; n < w; n++)
+    printf(" ");
+}
+
+// print v right-justified in a field of width w.
+void
+num(long v, int w)
+{
+  char buf[24];
+  int i = sizeof(buf) - 1, neg = v < 0;
+
+  if(neg)
+    v = -v;
+  buf[i] = 0;
+  do {
+    buf[--i] = '0' + v % 10;
+    v /= 10;
+  } while(v && i > 1);
+  if(neg)
+    buf[--i] = '-';
+  for(int n = sizeof(buf) - 1 - i; n < w; n++)
+    printf(" ");
+  printf("%s ", buf + i);
+}
+
+void
+sample(int delay)
+{
+  int nb, na, i, j, k;
+  uint64 t;
+
+  if((nb = procstat(before, MAXPROCS)) < 0){
+    fprintf(2, "top: procstat failed\n");
+    exit(1);
+  }
+  sleep(delay);
+  if((na = procstat(after, MAXPROCS)) < 0){
+    fprintf(2, "top: procstat failed\n");
+    exit(1);
+  }
+
+  for(i = 0; i < na; i++){
+    t = after[i].utime + after[i].stime;
+    for(j = 0; j < nb; j++){
+      if(before[j].pid == after[i].pid){
+        t -= before[j].utime + before[j].stime;
+        break;
+      }
+    }
+    pct[i] = t * 100 / ((uint64)delay * TICKCYCLES);
+    // busiest first.
+    for(k = i; k > 0 && pct[order[k-1]] < pct[i]; k--)
+      order[k] = order[k-1];
+    order[k] = i;
+  }
+
+  printf("uptime %d ticks, %d processes\n", uptime(), na);
+  printf("  PID STATE   NI HART %%CPU   USER    SYS   WAIT   VCSW  IVCSW   MEM NAME\n");
+  for(k = 0; k < na; k++){
+    struct procstat *ps = &after[order[k]];
+    num(ps->pid, 5);
+    col(ps->state >= 0 && ps->state < sizeof(states)/sizeof(states[0]) ?
+        states[ps->state] : "???", 6);
+    num(ps->nice, 4);
+    num(ps->hart, 4);
+    num(pct[order[k]], 4);
+    num(ps->utime / TICKCYCLES, 6);
+    num(ps->stime / TICKCYCLES, 6);
+    num(ps->wait / TICKCYCLES, 6);
+    num(ps->nvcsw, 6);
+    num(ps->nivcsw, 6);
+    num(ps->sz / 1024, 5);
+    printf("%s\n", ps->name);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int delay = 10, iterations = 1;
+
+  if(argc > 1)
+    delay = atoi(argv[1]);
+  if(argc > 2)
+    iterations = atoi(argv[2]);
+  if(delay < 1)
+    delay = 1;
+
+  for(int i = 0; i < iterations; i++){
+    if(i > 0)
+      printf("\n");
+    sample(delay);
+  }
+  exit(0);
+}
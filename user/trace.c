@@ -0,0 +1,154 @@
+// trace: record kernel events while a program runs.
+//
+// turns on the kernel's tracepoints through the trace
+// device, runs prog with its arguments, and prints the
+// events from every hart as they are drained: the time in
+// microseconds since the first, the hart, the pid running
+// there, the event and its arguments. each drain is sorted
+// by time; events from different drains are not merged.
+// mask chooses the events, as in kernel/trace.h; the
+// default is all of them. trace's own events are left out.
+//
+//   trace [-m mask] prog [args...]
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/fcntl.h"
+#include "kernel/poll.h"
+#include "kernel/trace.h"
+#include "user/user.h"
+
+#define NREAD 64
+
+char *names[] = {
+  [TR_LOST]     "lost",
+  [TR_SWITCH]   "switch",
+  [TR_SYSCALL]  "syscall",
+  [TR_SYSRET]   "sysret",
+  [TR_FAULT]    "fault",
+  [TR_BREAD]    "bread",
+  [TR_BWRITE]   "bwrite",
+  [TR_DISKSUB]  "disksub",
+  [TR_DISKDONE] "diskdone",
+  [TR_COMMIT]   "commit",
+};
+
+struct traceev ev[NREAD];
+uint64 t0;
+int self;
+
+static void
+print(struct traceev *e)
+{
+  int id = e->id & ~TR_STRACED;
+
+  if(t0 == 0)
+    t0 = e->time;
+  printf("%l\t%d\t%d\t", (e->time - t0) / (TIMEBASE / 1000000), e->cpu, e->pid);
+  printf("%s\t", id < NTRACEEV ? names[id] : "?");
+  switch(id){
+  case TR_LOST:
+    printf("%l events\n", e->arg[0]);
+    break;
+  case TR_SWITCH:
+    printf("to %d, state %d\n", (int)e->arg[0], (int)e->arg[1]);
+    break;
+  case TR_SYSCALL:
+    printf("%s(%p, %p, %p)\n", sysname(e->arg[0]), e->arg[1], e->arg[2], e->arg[3]);
+    break;
+  case TR_SYSRET:
+    printf("%s = %d\n", sysname(e->arg[0]), (int)e->arg[1]);
+    break;
+  case TR_FAULT:
+    printf("scause %p stval %p\n", e->arg[0], e->arg[1]);
+    break;
+  case TR_BREAD:
+    printf("block %d%s\n", (int)e->arg[0], e->arg[1] ? " from disk" : "");
+    break;
+  case TR_DISKSUB:
+    printf("block %d %s\n", (int)e->arg[0], e->arg[1] ? "write" : "read");
+    break;
+  case TR_COMMIT:
+    printf("%d blocks\n", (int)e->arg[0]);
+    break;
+  default:
+    printf("block %d\n", (int)e->arg[0]);
+    break;
+  }
+}
+
+// read and print the events so far.
+static void
+drain(int fd)
+{
+  struct traceev t;
+  int n, i, j;
+
+  while((n = read(fd, ev, sizeof(ev)) / sizeof(ev[0])) > 0){
+    for(i = 1; i < n; i++){
+      t = ev[i];
+      for(j = i; j > 0 && ev[j-1].time > t.time; j--)
+        ev[j] = ev[j-1];
+      ev[j] = t;
+    }
+    for(i = 0; i < n; i++)
+      if(ev[i].pid != self || ev[i].id == TR_LOST)
+        print(&ev[i]);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct pollfd pfd;
+  int fd, done[2], pid;
+  uint mask = TRACEALL, off = 0;
+
+  if(argc > 2 && strcmp(argv[1], "-m") == 0){
+    mask = atoi(argv[2]);
+    argc -= 2;
+    argv += 2;
+  }
+  if(argc < 2){
+    fprintf(2, "usage: trace [-m mask] prog [args...]\n");
+    exit(1);
+  }
+  if((fd = open("trace", O_RDWR)) < 0){
+    fprintf(2, "trace: cannot open trace\n");
+    exit(1);
+  }
+  self = getpid();
+
+  // the child holds done open until it exits.
+  pipe(done);
+  if(write(fd, &mask, sizeof(mask)) != sizeof(mask)){
+    fprintf(2, "trace: cannot set mask\n");
+    exit(1);
+  }
+  if((pid = fork()) < 0){
+    fprintf(2, "trace: fork failed\n");
+    exit(1);
+  }
+  if(pid == 0){
+    close(done[0]);
+    close(fd);
+    exec(argv[1], argv + 1);
+    fprintf(2, "trace: exec %s failed\n", argv[1]);
+    exit(1);
+  }
+  close(done[1]);
+
+  printf("time(us)\tcpu\tpid\tevent\n");
+  pfd.fd = done[0];
+  pfd.events = POLLIN;
+  for(;;){
+    poll(&pfd, 1, 1);
+    drain(fd);
+    if(pfd.revents)
+      break;
+  }
+  wait(0);
+  write(fd, &off, sizeof(off));
+  drain(fd);
+  exit(0);
+}
@@ -1,6 +1,10 @@
 #include "kernel/types.h"
 #include "kernel/stat.h"
 #include "kernel/fcntl.h"
+#include "kernel/param.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
+#include "kernel/vdso.h"
 #include "user/user.h"
 
 //
@@ -145,3 +149,47 @@ memcpy(void *dst, const void *src, uint n)
 {
   return memmove(dst, src, n);
 }
+
+// add inc to the calling process's nice value, clamped to
+// NICE_MIN..NICE_MAX. returns the new nice value.
+int
+nice(int inc)
+{
+  int n;
+
+  n = getpriority(0) + inc;
+  if(n < NICE_MIN)
+    n = NICE_MIN;
+  if(n > NICE_MAX)
+    n = NICE_MAX;
+  setpriority(0, n);
+  return n;
+}
+
+// the same as uptime(), getpid() and clock_gettime(), but
+// read from the vdso page and the time CSR without a trap.
+int
+vdso_uptime(void)
+{
+  struct vdso *v = (struct vdso*)VDSO;
+
+  return (r_time() - v->boottime) / v->tickcycles;
+}
+
+int
+vdso_getpid(void)
+{
+  struct vdso *v = (struct vdso*)VDSO;
+
+  if(v->pid == 0)
+    return getpid();
+  return v->pid;
+}
+
+uint64
+vdso_clock(void)
+{
+  struct vdso *v = (struct vdso*)VDSO;
+
+  return r_time() * (1000000000 / v->timebase);
+}
@@ -1,4 +1,12 @@
 struct stat;
+struct cpustat;
+struct procstat;
+struct ring;
+struct pollfd;
+struct regset;
+struct samplering;
+struct scstat;
+struct lockstat;
 
 // system calls
 int fork(void);
@@ -24,6 +32,32 @@ int sleep(int);
 int uptime(void);
 int dump(void);
 int dump2(int, int, uint64*);
+int setpriority(int, int);
+int getpriority(int);
+int cpustat(struct cpustat*, int);
+int sethandoff(int);
+int clone(void(*)(void*), void*, void*);
+int join(int, int*);
+char* sbrkshared(int);
+int futex_wait(int*, int, int);
+int futex_wake(int*, int);
+int sched_setaffinity(int, int);
+int sched_getaffinity(int);
+int procstat(struct procstat*, int);
+int nanosleep(uint64);
+int clock_gettime(uint64*);
+struct ring* ringsetup(void);
+int ringenter(int);
+int poll(struct pollfd*, int, int);
+int regsnap(int*, int, uint64, struct regset*);
+struct samplering* sampleattach(int, uint64);
+int sampledetach(void);
+int kprof(int, void*, int);
+int scstat(struct scstat*, int, int);
+int trace(uint64);
+int lockstat(struct lockstat*, int, int);
+int lockbench(int, int);
+int setsleepspin(int);
 
 // ulib.c
 int stat(const char*, struct stat*);
@@ -41,3 +75,32 @@ void free(void*);
 int atoi(const char*);
 int memcmp(const void *, const void *, uint);
 void *memcpy(void *, const void *, uint);
+int nice(int);
+int vdso_uptime(void);
+int vdso_getpid(void);
+uint64 vdso_clock(void);
+
+// sysname.c
+char* sysname(int);
+
+// thread.c
+// a mutex or condition variable works between threads, or
+// between processes if it is in memory from sbrkshared().
+// zero-filled ones are ready for use.
+struct mutex {
+  int state;            // 0 free, 1 held, 2 held and contended
+};
+struct cond {
+  int seq;              // bumped by each signal or broadcast
+};
+int thread_create(void (*)(void*), void*);
+int thread_join(int);
+void mutex_init(struct mutex*);
+void mutex_lock(struct mutex*);
+int mutex_trylock(struct mutex*);
+void mutex_unlock(struct mutex*);
+void cond_init(struct cond*);
+void cond_wait(struct cond*, struct mutex*);
+int cond_timedwait(struct cond*, struct mutex*, int);
+void cond_signal(struct cond*);
+void cond_broadcast(struct cond*);
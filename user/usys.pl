@@ -38,3 +38,29 @@ entry("sleep");
 entry("uptime");
 entry("dump");
 entry("dump2");
+entry("setpriority");
+entry("getpriority");
+entry("cpustat");
+entry("sethandoff");
+entry("clone");
+entry("join");
+entry("sbrkshared");
+entry("futex_wait");
+entry("futex_wake");
+entry("sched_setaffinity");
+entry("sched_getaffinity");
+entry("procstat");
+entry("nanosleep");
+entry("clock_gettime");
+entry("ringsetup");
+entry("ringenter");
+entry("poll");
+entry("regsnap");
+entry("sampleattach");
+entry("sampledetach");
+entry("kprof");
+entry("scstat");
+entry("trace");
+entry("lockstat");
+entry("lockbench");
+entry("setsleepspin");
@@ -0,0 +1,76 @@
+// vdsobench: system calls against the vdso page.
+//
+// calls uptime(), getpid() and clock_gettime() n times
+// each, then their vdso_ counterparts from user/ulib.c,
+// which read the vdso page and the time CSR instead of
+// trapping into the kernel, and reports the nanoseconds
+// per call of each. checks that both agree.
+//
+//   vdsobench [n]
+
+#include "kernel/types.h"
+#include "user/user.h"
+
+int n = 100000;
+
+// nanoseconds per call of a loop of n that started at t0.
+static uint64
+percall(uint64 t0)
+{
+  return (vdso_clock() - t0) / n;
+}
+
+int
+main(int argc, char *argv[])
+{
+  uint64 t0, ns, sys, fast;
+  volatile int sink = 0;
+  int i;
+
+  if(argc > 1)
+    n = atoi(argv[1]);
+  if(n < 1)
+    n = 1;
+
+  if(vdso_getpid() != getpid()){
+    fprintf(2, "vdsobench: vdso pid %d, getpid %d\n", vdso_getpid(), getpid());
+    exit(1);
+  }
+  if(vdso_uptime() - uptime() > 1){
+    fprintf(2, "vdsobench: vdso uptime %d, uptime %d\n", vdso_uptime(), uptime());
+    exit(1);
+  }
+
+  t0 = vdso_clock();
+  for(i = 0; i < n; i++)
+    sink += uptime();
+  sys = percall(t0);
+  t0 = vdso_clock();
+  for(i = 0; i < n; i++)
+    sink += vdso_uptime();
+  fast = percall(t0);
+  printf("vdsobench: uptime: syscall %l ns, vdso %l ns\n", sys, fast);
+
+  t0 = vdso_clock();
+  for(i = 0; i < n; i++)
+    sink += getpid();
+  sys = percall(t0);
+  t0 = vdso_clock();
+  for(i = 0; i < n; i++)
+    sink += vdso_getpid();
+  fast = percall(t0);
+  printf("vdsobench: getpid: syscall %l ns, vdso %l ns\n", sys, fast);
+
+  t0 = vdso_clock();
+  for(i = 0; i < n; i++){
+    clock_gettime(&ns);
+    sink += ns;
+  }
+  sys = percall(t0);
+  t0 = vdso_clock();
+  for(i = 0; i < n; i++)
+    sink += vdso_clock();
+  fast = percall(t0);
+  printf("vdsobench: clock: syscall %l ns, vdso %l ns\n", sys, fast);
+  exit(0);
+}